@@ -0,0 +1,372 @@
+#include "ClusterGraph.h"
+#include <algorithm>
+#include <cstdlib>
+
+// runs of open border at least this long get a crossing at both ends instead of one in the middle
+static const int longEntrance = 6;
+
+static inline int Heuristic(const IPoint &a, const IPoint &b)
+{
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+}
+
+void ClusterGraph::Build(const Map &newMap, int clusterSize)
+{
+    clusterSize = std::max(2, clusterSize);
+    if (map == &newMap && size == clusterSize && clustersX == (newMap.width + size - 1) / size &&
+        clustersY == (newMap.height + size - 1) / size)
+        return;
+
+    map = &newMap;
+    size = clusterSize;
+    clustersX = (map->width + size - 1) / size;
+    clustersY = (map->height + size - 1) / size;
+
+    nodes.clear();
+    freeNodes.clear();
+    clusterNodes.assign((size_t)clustersX * clustersY, std::vector<int>());
+    nodeCount = 0;
+    floodCluster = -1;
+    floodStride = size + 2;
+    floodOpen.resize((size_t)floodStride * floodStride);
+    floodDistance.resize(floodOpen.size());
+    floodParent.resize(floodOpen.size());
+    floodQueue.resize(floodOpen.size());
+    search.clear();
+    generation = 0;
+
+    for (int cluster = 0; cluster < ClusterCount(); ++cluster)
+    {
+        ConnectBorder(cluster, true);
+        ConnectBorder(cluster, false);
+    }
+    for (int cluster = 0; cluster < ClusterCount(); ++cluster)
+        ConnectInside(cluster);
+}
+
+void ClusterGraph::TileChanged(int x, int y)
+{
+    if (!map || x < 0 || y < 0 || x >= map->width || y >= map->height)
+        return;
+
+    // the tile can open or close crossings on any border of its cluster, which changes the nodes of the
+    // neighbours on the other side too
+    const int cluster = ClusterOf(x, y);
+    if (floodCluster == cluster)
+        floodCluster = -1;
+    const int cx = cluster % clustersX;
+    const int cy = cluster / clustersX;
+    DisconnectBorders(cluster);
+    if (cx > 0)
+        ConnectBorder(cluster - 1, true);
+    ConnectBorder(cluster, true);
+    if (cy > 0)
+        ConnectBorder(cluster - clustersX, false);
+    ConnectBorder(cluster, false);
+
+    ConnectInside(cluster);
+    if (cx > 0)
+        ConnectInside(cluster - 1);
+    if (cx + 1 < clustersX)
+        ConnectInside(cluster + 1);
+    if (cy > 0)
+        ConnectInside(cluster - clustersX);
+    if (cy + 1 < clustersY)
+        ConnectInside(cluster + clustersX);
+}
+
+int ClusterGraph::NodeAt(const IPoint &tile)
+{
+    std::vector<int> &inCluster = clusterNodes[ClusterOf(tile)];
+    for (int node : inCluster)
+        if (nodes[node].tile == tile)
+            return node;
+
+    int node;
+    if (!freeNodes.empty())
+    {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else
+    {
+        node = (int)nodes.size();
+        nodes.emplace_back();
+    }
+    nodes[node].tile = tile;
+    inCluster.push_back(node);
+    ++nodeCount;
+    return node;
+}
+
+void ClusterGraph::FreeNode(int node)
+{
+    std::vector<int> &inCluster = clusterNodes[ClusterOf(nodes[node].tile)];
+    inCluster.erase(std::find(inCluster.begin(), inCluster.end(), node));
+    nodes[node].across.clear();
+    nodes[node].inside.clear();
+    freeNodes.push_back(node);
+    --nodeCount;
+}
+
+void ClusterGraph::ConnectBorder(int cluster, bool horizontal)
+{
+    const int cx = cluster % clustersX;
+    const int cy = cluster / clustersX;
+    if (horizontal ? cx + 1 >= clustersX : cy + 1 >= clustersY)
+        return;
+
+    // the last column (row) of the cluster and the first of its neighbour
+    const int step = horizontal ? 1 : 0;
+    const int borderX = horizontal ? (cx + 1) * size - 1 : cx * size;
+    const int borderY = horizontal ? cy * size : (cy + 1) * size - 1;
+    const int length = horizontal ? std::min(size, map->height - borderY) : std::min(size, map->width - borderX);
+
+    auto link = [&](int along) {
+        const IPoint a = {borderX + (horizontal ? 0 : along), borderY + (horizontal ? along : 0)};
+        const IPoint b = {a.x + step, a.y + 1 - step};
+        const int na = NodeAt(a);
+        const int nb = NodeAt(b);
+        nodes[na].across.push_back(nb);
+        nodes[nb].across.push_back(na);
+    };
+
+    int runStart = -1;
+    for (int along = 0; along <= length; ++along)
+    {
+        const int x = borderX + (horizontal ? 0 : along);
+        const int y = borderY + (horizontal ? along : 0);
+        const bool open = along < length && Open(x, y) && Open(x + step, y + 1 - step);
+        if (open && runStart < 0)
+            runStart = along;
+        if (open || runStart < 0)
+            continue;
+
+        const int run = along - runStart;
+        if (run < longEntrance)
+        {
+            link(runStart + run / 2);
+        }
+        else
+        {
+            link(runStart);
+            link(along - 1);
+        }
+        runStart = -1;
+    }
+}
+
+void ClusterGraph::DisconnectBorders(int cluster)
+{
+    const std::vector<int> inCluster = clusterNodes[cluster];
+    for (int node : inCluster)
+    {
+        for (int other : nodes[node].across)
+        {
+            std::vector<int> &across = nodes[other].across;
+            across.erase(std::find(across.begin(), across.end(), node));
+            if (across.empty())
+                FreeNode(other);
+        }
+        FreeNode(node);
+    }
+}
+
+void ClusterGraph::ConnectInside(int cluster)
+{
+    const std::vector<int> &inCluster = clusterNodes[cluster];
+    for (int node : inCluster)
+        nodes[node].inside.clear();
+
+    // distances are the same both ways, so each node floods for the ones after it
+    for (size_t i = 0; i + 1 < inCluster.size(); ++i)
+    {
+        Flood(nodes[inCluster[i]].tile);
+        for (size_t j = i + 1; j < inCluster.size(); ++j)
+        {
+            const int distance = floodDistance[FloodIndex(nodes[inCluster[j]].tile)];
+            if (distance < 0)
+                continue;
+            nodes[inCluster[i]].inside.push_back({inCluster[j], distance});
+            nodes[inCluster[j]].inside.push_back({inCluster[i], distance});
+        }
+    }
+}
+
+void ClusterGraph::LoadCluster(int cluster)
+{
+    if (cluster == floodCluster)
+        return;
+    floodCluster = cluster;
+    floodX = cluster % clustersX * size;
+    floodY = cluster / clustersX * size;
+    const int width = std::min(size, map->width - floodX);
+    const int height = std::min(size, map->height - floodY);
+    std::fill(floodOpen.begin(), floodOpen.end(), 0);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            floodOpen[(y + 1) * floodStride + x + 1] = Open(floodX + x, floodY + y);
+}
+
+void ClusterGraph::Flood(const IPoint &tile, const IPoint *stopAt)
+{
+    LoadCluster(ClusterOf(tile));
+    const int stop = stopAt ? FloodIndex(*stopAt) : -1;
+    std::fill(floodDistance.begin(), floodDistance.end(), -1);
+
+    // neighbour offsets, in the order AStarTilePath expands them
+    const int offsets[4] = {1, -1, floodStride, -floodStride};
+    const int start = FloodIndex(tile);
+    floodDistance[start] = 0;
+    floodParent[start] = -1;
+    int head = 0;
+    int tail = 0;
+    floodQueue[tail++] = start;
+    while (head < tail)
+    {
+        const int index = floodQueue[head++];
+        if (index == stop)
+            break;
+        for (int offset : offsets)
+        {
+            const int next = index + offset;
+            if (!floodOpen[next] || floodDistance[next] >= 0)
+                continue;
+            floodDistance[next] = floodDistance[index] + 1;
+            floodParent[next] = index;
+            floodQueue[tail++] = next;
+        }
+    }
+    flooded += tail;
+}
+
+bool ClusterGraph::FindRoute(const IPoint &start, const IPoint &goal, ClusterRoute &route)
+{
+    route.waypoints.clear();
+    route.next = 0;
+    expanded = 0;
+    flooded = 0;
+    if (!map || start.x < 0 || start.y < 0 || start.x >= map->width || start.y >= map->height ||
+        goal.x < 0 || goal.y < 0 || goal.x >= map->width || goal.y >= map->height)
+        return false;
+    if (!Open(start.x, start.y) || !Open(goal.x, goal.y))
+        return false;
+
+    // the start and goal join the graph as two extra nodes, connected to the nodes of their cluster
+    const int startNode = (int)nodes.size();
+    const int goalNode = startNode + 1;
+    const int startCluster = ClusterOf(start);
+    const int goalCluster = ClusterOf(goal);
+    Flood(goal);
+    goalEdges.clear();
+    for (int node : clusterNodes[goalCluster])
+    {
+        const int distance = floodDistance[FloodIndex(nodes[node].tile)];
+        if (distance >= 0)
+            goalEdges.push_back({node, distance});
+    }
+
+    Flood(start);
+    startEdges.clear();
+    for (int node : clusterNodes[startCluster])
+    {
+        const int distance = floodDistance[FloodIndex(nodes[node].tile)];
+        if (distance >= 0)
+            startEdges.push_back({node, distance});
+    }
+    if (goalCluster == startCluster && floodDistance[FloodIndex(goal)] >= 0)
+        startEdges.push_back({goalNode, floodDistance[FloodIndex(goal)]});
+
+    // A* over the graph, with the search state stamped like PathSearch's
+    if (search.size() < nodes.size() + 2)
+        search.resize(nodes.size() + 2);
+    if (++generation >= 0x7FFFFFFFu)
+    {
+        std::fill(search.begin(), search.end(), SearchNode());
+        generation = 1;
+    }
+    open.clear();
+
+    auto tileOf = [&](int node) { return node == startNode ? start : node == goalNode ? goal : nodes[node].tile; };
+    auto closed = [&](int node) { return search[node].stamp == (generation << 1 | 1); };
+    auto relax = [&](int from, int to, int cost) {
+        if (closed(to))
+            return;
+        const int g = search[from].g + cost;
+        if ((search[to].stamp >> 1) == generation && g >= search[to].g)
+            return;
+        search[to] = {generation << 1, g, from};
+        open.push_back({to, g + Heuristic(tileOf(to), goal), g});
+        std::push_heap(open.begin(), open.end());
+    };
+
+    search[startNode] = {generation << 1, 0, -1};
+    open.push_back({startNode, Heuristic(start, goal), 0});
+    while (!open.empty())
+    {
+        const OpenItem cur = open.front();
+        std::pop_heap(open.begin(), open.end());
+        open.pop_back();
+        if (closed(cur.node))
+            continue;
+        search[cur.node].stamp |= 1;
+        ++expanded;
+
+        if (cur.node == goalNode)
+        {
+            for (int node = goalNode; node != -1; node = search[node].parent)
+                route.waypoints.push_back(tileOf(node));
+            std::reverse(route.waypoints.begin(), route.waypoints.end());
+            route.next = 1;
+            return true;
+        }
+
+        if (cur.node == startNode)
+        {
+            for (const Edge &edge : startEdges)
+                relax(cur.node, edge.to, edge.cost);
+            continue;
+        }
+        const Node &node = nodes[cur.node];
+        for (const Edge &edge : node.inside)
+            relax(cur.node, edge.to, edge.cost);
+        for (int other : node.across)
+            relax(cur.node, other, 1);
+        if (ClusterOf(node.tile) == goalCluster)
+            for (const Edge &edge : goalEdges)
+                if (edge.to == cur.node)
+                    relax(cur.node, goalNode, edge.cost);
+    }
+    return false;
+}
+
+bool ClusterGraph::NextSegment(ClusterRoute &route, std::vector<IPoint> &path)
+{
+    path.clear();
+    if (!map || route.Done())
+        return false;
+
+    // every segment is either a step across a border or lies inside one cluster
+    const IPoint from = route.waypoints[route.next - 1];
+    const IPoint to = route.waypoints[route.next];
+    ++route.next;
+    if (Heuristic(from, to) <= 1)
+    {
+        path.push_back(from);
+        if (to != from)
+            path.push_back(to);
+        return true;
+    }
+
+    if (ClusterOf(to) != ClusterOf(from))
+        return false; // the map changed since the route was found
+    Flood(from, &to);
+    if (floodDistance[FloodIndex(to)] < 0)
+        return false; // the map changed since the route was found
+
+    int index = FloodIndex(to);
+    path.resize(floodDistance[index] + 1);
+    for (size_t out = path.size(); out-- > 0; index = floodParent[index])
+        path[out] = FloodTile(index);
+    return true;
+}
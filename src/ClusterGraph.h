@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Pathfinding.h"
+
+// A route found on the cluster graph: the tiles where it crosses from one cluster into the next. It is
+// turned into tile paths one cluster at a time with ClusterGraph::NextSegment as the walker goes.
+struct ClusterRoute
+{
+    std::vector<IPoint> waypoints; // start, the tiles on both sides of every border crossed, goal
+    size_t next = 0;               // the waypoint the next segment leads to
+
+    bool Done() const { return next >= waypoints.size(); }
+};
+
+// Hierarchical pathfinding (HPA*) for large maps. The map is split into square clusters. Where open floor
+// runs along both sides of a border between two clusters, the border gets one crossing (two on long runs),
+// a node on either side. The nodes of a cluster are connected by their walking distance inside it. A route
+// searches this graph plus the start and goal tiles, so its cost depends on the number of clusters between
+// them, not on the size of the map, and the tile path is only searched inside one cluster at a time.
+//
+// Routes are typically a few percent longer than the shortest path, since they pass the border crossings.
+class ClusterGraph
+{
+public:
+    static const int defaultClusterSize = 16;
+
+    // split map into clusters and connect them, unless the graph was built for it already
+    void Build(const Map &map, int clusterSize = defaultClusterSize);
+
+    // forget the map, so the next Build starts over (e.g. after another level was loaded into the same Map)
+    void Invalidate() { map = nullptr; }
+
+    // the tile at (x, y) of the map was changed in place: rebuild the crossings of its cluster and the
+    // distances in it and its four neighbours, the only ones it can affect
+    void TileChanged(int x, int y);
+
+    // search the graph from start to goal. False, with route empty, if goal can't be reached
+    bool FindRoute(const IPoint &start, const IPoint &goal, ClusterRoute &route);
+
+    // the tile path to route's next waypoint (both ends included) into path. False when the route is done
+    bool NextSegment(ClusterRoute &route, std::vector<IPoint> &path);
+
+    int NodeCount() const { return nodeCount; }
+    int ClusterCount() const { return clustersX * clustersY; }
+
+    // graph nodes taken off the open list by the last FindRoute
+    int Expanded() const { return expanded; }
+
+    // tiles reached by the floods inside clusters since the last FindRoute started, NextSegment's included
+    int Flooded() const { return flooded; }
+
+private:
+    struct Edge
+    {
+        int to;
+        int cost;
+    };
+    struct Node
+    {
+        IPoint tile;
+        std::vector<int> across; // the nodes on the other side of this node's borders, one step away
+        std::vector<Edge> inside; // the other nodes of the cluster it can walk to within the cluster
+    };
+
+    int ClusterOf(int x, int y) const { return (y / size) * clustersX + x / size; }
+    int ClusterOf(const IPoint &tile) const { return ClusterOf(tile.x, tile.y); }
+    bool Open(int x, int y) const { return map->Walkable(x, y); }
+
+    // the node on tile, created if it has none
+    int NodeAt(const IPoint &tile);
+    void FreeNode(int node);
+
+    // put crossings on the border of cluster and its right (horizontal) or lower neighbour
+    void ConnectBorder(int cluster, bool horizontal);
+    // remove every crossing on the borders of cluster, and the nodes left without one
+    void DisconnectBorders(int cluster);
+    // walking distances between the nodes of cluster
+    void ConnectInside(int cluster);
+
+    // copy which tiles of cluster are open into floodOpen, unless it holds that cluster already
+    void LoadCluster(int cluster);
+    // breadth-first from tile within its cluster into the flood arrays, until it reaches stopAt if given
+    void Flood(const IPoint &tile, const IPoint *stopAt = nullptr);
+    int FloodIndex(const IPoint &tile) const { return (tile.y - floodY + 1) * floodStride + tile.x - floodX + 1; }
+    IPoint FloodTile(int index) const { return {floodX + index % floodStride - 1, floodY + index / floodStride - 1}; }
+
+    const Map *map = nullptr;
+    int size = 0;
+    int clustersX = 0;
+    int clustersY = 0;
+
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    std::vector<std::vector<int>> clusterNodes; // per cluster, its node ids
+    int nodeCount = 0;
+
+    // Flood: the tiles of one cluster with a closed ring around it, so the flood needs no bounds checks.
+    // Distance and the tile it was reached from per tile, -1 if not reached
+    int floodCluster = -1;
+    int floodX = 0;
+    int floodY = 0;
+    int floodStride = 0;
+    std::vector<uint8_t> floodOpen;
+    std::vector<int> floodDistance;
+    std::vector<int> floodParent;
+    std::vector<int> floodQueue;
+
+    // FindRoute: generation stamped search state per node, plus the start and goal at the end
+    struct SearchNode
+    {
+        uint32_t stamp = 0;
+        int g = 0;
+        int parent = -1;
+    };
+    struct OpenItem
+    {
+        int node;
+        int f;
+        int g;
+        // min-heap on f; among equal f the deepest first, which on open ground follows one of the many
+        // equally short routes instead of widening over all of them
+        bool operator<(const OpenItem &other) const { return f > other.f || (f == other.f && g < other.g); }
+    };
+    std::vector<SearchNode> search;
+    std::vector<OpenItem> open;
+    std::vector<Edge> startEdges;
+    std::vector<Edge> goalEdges; // by node, the distance to the goal of the goal cluster's nodes
+    uint32_t generation = 0;
+    int expanded = 0;
+    int flooded = 0;
+};
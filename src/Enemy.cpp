@@ -1,121 +1,162 @@
 #include "Enemy.h"
-#include <SDL3/SDL.h>
 #include <cmath>
-#include <d2d1.h>
+#include "EnemyStore.h"
+#include "FlowField.h"
+#include "Platform.h"
 #include "raycastTest.h" // for canMove, getTile
+#include "Profiler.h"
 
 static inline float length2(float x, float y) { return x*x + y*y; }
 static inline float length(float x, float y) { return std::sqrt(length2(x,y)); }
 
-// Helper: find nearest walkable tile around a center within a given radius
-static IPoint FindNearestWalkableAround(const IPoint& center, int maxRadius)
+static void RequestPath(EnemyPath &path, const IPoint& playerTile)
 {
-    if (IsWalkable(center.x, center.y)) return center;
-    for (int r = 1; r <= maxRadius; ++r) {
-        // scan a diamond ring (Manhattan distance r)
-        for (int dx = -r; dx <= r; ++dx) {
-            int dy1 = r - std::abs(dx);
-            int dy2 = -dy1;
-            int tx1 = center.x + dx;
-            int ty1 = center.y + dy1;
-            int tx2 = center.x + dx;
-            int ty2 = center.y + dy2;
-            if (IsWalkable(tx1, ty1)) return {tx1, ty1};
-            if (IsWalkable(tx2, ty2)) return {tx2, ty2};
-        }
+    IPoint goal = playerTile;
+    if (!IsWalkable(goal.x, goal.y)) {
+        goal = FindNearestWalkableAround(goal, 3);
     }
-    return center; // fallback to center; A* will return empty if not walkable
+
+    // searched by the PathScheduler, from wherever the enemy is by then
+    path.requested = true;
+    path.requestGoal = goal;
 }
 
-// Update enemy state and pathfollow toward player
-void Enemy::Update(float dt, const D2D_POINT_2F &playerPos)
+// one step of enemy i toward target at its speed. False if a wall is in the way
+static bool StepToward(EnemyStore &enemies, size_t i, const D2D_POINT_2F &targetPos, float dist, float dt)
 {
-    // Stationary targets do not move or pathfind
-    if (type == EnemyType::Target) {
-        return;
-    }
+    D2D_POINT_2F &pos = enemies.pos[i];
+    const float speed = enemies.config[i].moveSpeed;
+    float vx = ((targetPos.x - pos.x) / dist) * speed;
+    float vy = ((targetPos.y - pos.y) / dist) * speed;
 
-    timeSinceAttack += dt;
-    timeSinceRepath += dt;
+    D2D_POINT_2F nextPos = { pos.x + vx * dt, pos.y + vy * dt };
+    if (!canMove(nextPos, {0.3f, 0.3f})) {
+        return false;
+    }
+    pos = nextPos;
+    return true;
+}
 
-    IPoint myTile = WorldToTile(pos);
-    IPoint playerTile = WorldToTile(playerPos);
+static void MoveAlongPath(EnemyStore &enemies, size_t i, float dt)
+{
+    const std::vector<IPoint> &tiles = enemies.path[i].tiles;
+    int &pathIndex = enemies.pathIndex[i];
+    if (tiles.empty() || pathIndex >= (int)tiles.size()) {
+        return;
+    }
 
-    // Repath conditions
-    if (!haveLastPlayerTile || lastPlayerTile != playerTile || timeSinceRepath >= repathInterval || path.empty() || pathIndex >= (int)path.size()) {
-        EnsurePath(myTile, playerTile);
-        lastPlayerTile = playerTile;
-        haveLastPlayerTile = true;
-        timeSinceRepath = 0.0f;
+    D2D_POINT_2F targetPos = TileCenter(tiles[pathIndex]);
+    float dist = length(targetPos.x - enemies.pos[i].x, targetPos.y - enemies.pos[i].y);
+    if (dist < 0.05f) {
+        pathIndex++;
+        return;
     }
 
-    MoveAlongPath(dt);
+    if (!StepToward(enemies, i, targetPos, dist, dt)) {
+        // If blocked, re-path on next update cycle
+        enemies.timeSinceRepath[i] = enemies.config[i].repathInterval;
+    }
 }
 
-// Attempt to attack the player
-bool Enemy::TryAttack(const D2D_POINT_2F &playerPos)
+static void FollowFlow(EnemyStore &enemies, size_t i, float dt, const FlowField &flow)
 {
-    // Stationary targets don't attack
-    if (type == EnemyType::Target) {
-        return false;
+    // like a path: first the center of the own tile, then one tile toward the player after another
+    IPoint &waypoint = enemies.waypoint[i];
+    if (waypoint.x < 0) {
+        waypoint = WorldToTile(enemies.pos[i]);
+    }
+
+    D2D_POINT_2F targetPos = TileCenter(waypoint);
+    float dist = length(targetPos.x - enemies.pos[i].x, targetPos.y - enemies.pos[i].y);
+    if (dist < 0.05f) {
+        // on to the next tile. None at the player's tile or out of the field's reach: wait here
+        IPoint next;
+        if (flow.Next(waypoint, next))
+            waypoint = next;
+        return;
     }
 
-    float dx = pos.x - playerPos.x;
-    float dy = pos.y - playerPos.y;
-    float dist = std::sqrt(dx*dx + dy*dy);
-    if (dist <= attackRange && timeSinceAttack >= attackInterval)
-    {
-        timeSinceAttack = 0.0f;
-        SDL_Log("Enemy attacked!");
-        return true;
+    if (!StepToward(enemies, i, targetPos, dist, dt)) {
+        // If blocked, center on the current tile again
+        waypoint = {-1, -1};
     }
-    return false;
 }
 
-void Enemy::EnsurePath(const IPoint& myTile, const IPoint& playerTile)
+// Update enemy state and request paths toward player
+void UpdateEnemies(EnemyStore &enemies, float dt, const D2D_POINT_2F &playerPos, const FlowField *flow,
+                   ClusterGraph *clusters)
 {
-    char myChar = InBounds(myTile.x, myTile.y) ? getTile(myTile.x, myTile.y) : '?';
-    char plChar = InBounds(playerTile.x, playerTile.y) ? getTile(playerTile.x, playerTile.y) : '?';
+    const IPoint playerTile = WorldToTile(playerPos);
+    for (size_t i = 0; i < enemies.Size(); ++i) {
+        // Stationary targets do not move or pathfind
+        if (enemies.type[i] == EnemyType::Target) {
+            continue;
+        }
 
-    // Debug: show what tiles we’re reading from raycastTest
-    SDL_Log("Enemy EnsurePath: myTile=(%d,%d,'%c') playerTile=(%d,%d,'%c')",
-            myTile.x, myTile.y, myChar, playerTile.x, playerTile.y, plChar);
+        enemies.timeSinceAttack[i] += dt;
+        if (flow) {
+            continue;
+        }
 
-    IPoint goal = playerTile;
-    if (!IsWalkable(goal.x, goal.y)) {
-        goal = FindNearestWalkableAround(goal, 3);
-    }
+        EnemyPath &path = enemies.path[i];
+        int &pathIndex = enemies.pathIndex[i];
+        float &timeSinceRepath = enemies.timeSinceRepath[i];
+        enemies.waypoint[i] = {-1, -1};
+        timeSinceRepath += dt;
 
-    // compute new path with A*
-    path = AStarTilePath(myTile, goal);
-    pathIndex = 0;
-}
+        // the next cluster of a route is only searched once the enemy has walked through the current one
+        if (clusters && pathIndex >= (int)path.tiles.size() && clusters->NextSegment(path.route, path.tiles)) {
+            pathIndex = 0;
+        }
 
-void Enemy::MoveAlongPath(float dt)
-{
-    if (path.empty() || pathIndex >= (int)path.size()) {
-        return;
+        // Repath conditions
+        if (!path.haveLastPlayerTile || path.lastPlayerTile != playerTile ||
+            timeSinceRepath >= enemies.config[i].repathInterval || path.tiles.empty() ||
+            pathIndex >= (int)path.tiles.size()) {
+            RequestPath(path, playerTile);
+            path.lastPlayerTile = playerTile;
+            path.haveLastPlayerTile = true;
+            timeSinceRepath = 0.0f;
+        }
     }
+}
 
-    IPoint nextTile = path[pathIndex];
-    D2D_POINT_2F targetPos = TileCenter(nextTile);
+void MoveEnemies(EnemyStore &enemies, float dt, const FlowField *flow)
+{
+    for (size_t i = 0; i < enemies.Size(); ++i) {
+        if (enemies.type[i] == EnemyType::Target) {
+            continue;
+        }
 
-    float dx = targetPos.x - pos.x;
-    float dy = targetPos.y - pos.y;
-    float dist = std::sqrt(dx*dx + dy*dy);
-    if (dist < 0.05f) {
-        pathIndex++;
-        return;
+        if (flow) {
+            FollowFlow(enemies, i, dt, *flow);
+        } else {
+            MoveAlongPath(enemies, i, dt);
+        }
     }
+}
 
-    float vx = (dx / dist) * moveSpeed;
-    float vy = (dy / dist) * moveSpeed;
+// Attempt to attack the player
+int EnemiesAttack(EnemyStore &enemies, const D2D_POINT_2F &playerPos)
+{
+    int attacks = 0;
+    for (size_t i = 0; i < enemies.Size(); ++i) {
+        // Stationary targets don't attack
+        if (enemies.type[i] == EnemyType::Target) {
+            continue;
+        }
 
-    D2D_POINT_2F nextPos = { pos.x + vx * dt, pos.y + vy * dt };
-    if (canMove(nextPos, {0.3f, 0.3f})) {
-        pos = nextPos;
-    } else {
-        // If blocked, re-path on next update cycle
-        timeSinceRepath = repathInterval;
+        const EnemyConfig &config = enemies.config[i];
+        if (enemies.timeSinceAttack[i] < config.attackInterval) {
+            continue;
+        }
+        float dist = length(enemies.pos[i].x - playerPos.x, enemies.pos[i].y - playerPos.y);
+        if (dist <= config.attackRange)
+        {
+            enemies.timeSinceAttack[i] = 0.0f;
+            SDL_Log("Enemy attacked!");
+            ++attacks;
+        }
     }
-}
\ No newline at end of file
+    return attacks;
+}
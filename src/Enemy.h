@@ -1,9 +1,11 @@
 #pragma once
-#include <Windows.h>
-#include <d2d1.h>
-#include <d2d1helper.h>
 #include <vector>
+#include "Platform.h"
 #include "Pathfinding.h"
+#include "ClusterGraph.h"
+
+class EnemyStore;
+class FlowField;
 
 // New: type of enemy so we can support stationary targets
 enum class EnemyType {
@@ -11,35 +13,39 @@ enum class EnemyType {
     Target // stationary target that doesn't move or attack
 };
 
-struct Enemy {
-    D2D_POINT_2F pos;
+// Tuning of one enemy, set when it is spawned
+struct EnemyConfig {
     int hp = 1;
     int damage = 1;
     float attackInterval = 2.0f; // seconds
-    float timeSinceAttack = 0.0f;
     float attackRange = 1.2f; // tiles
 
     // Pathfollowing (ignored for Target)
     float moveSpeed = 1.2f;        // tiles per second
     float repathInterval = 2.0f;   // seconds
-    float timeSinceRepath = 0.0f;
-    std::vector<IPoint> path;
-    int pathIndex = 0;
+};
+
+// Path following state of one enemy. Owns the path's memory, so it is kept apart from the fields the
+// per frame loops read
+struct EnemyPath {
+    std::vector<IPoint> tiles;
     bool haveLastPlayerTile = false;
     IPoint lastPlayerTile{0,0};
+    ClusterRoute route; // with a cluster graph: the rest of the way, tiles holds the current cluster's part
 
-    EnemyType type = EnemyType::Walker;
-
-    Enemy() : pos{0.f, 0.f}, type(EnemyType::Walker) {}
-    explicit Enemy(D2D_POINT_2F p, EnemyType t = EnemyType::Walker) : pos{p}, type(t) {}
+    // a new path toward requestGoal is waiting for the PathScheduler; the old one is followed meanwhile
+    bool requested = false;
+    IPoint requestGoal{0,0};
+};
 
-    // Update with player position (required for pathfinding)
-    void Update(float dt, const D2D_POINT_2F &playerPos);
+// Update with player position (required for pathfinding): walkers whose path is stale request a new one
+// toward the player. With a cluster graph the next cluster of a route is searched here once the walker
+// has walked through the current one. A flow field toward the player needs no paths
+void UpdateEnemies(EnemyStore &enemies, float dt, const D2D_POINT_2F &playerPos, const FlowField *flow = nullptr,
+                   ClusterGraph *clusters = nullptr);
 
-    bool TryAttack(const D2D_POINT_2F &playerPos);
+// walk along the paths, or the flow field if there is one
+void MoveEnemies(EnemyStore &enemies, float dt, const FlowField *flow = nullptr);
 
-private:
-    void EnsurePath(const IPoint& myTile, const IPoint& playerTile);
-    void MoveAlongPath(float dt);
-}
-;
\ No newline at end of file
+// walkers in range whose attack is ready attack the player. Returns how many did
+int EnemiesAttack(EnemyStore &enemies, const D2D_POINT_2F &playerPos);
@@ -0,0 +1,276 @@
+#include "EnemyGrid.h"
+#include <algorithm>
+#include <cmath>
+
+void EnemyGrid::Resize(int newWidth, int newHeight)
+{
+    width = std::max(1, newWidth);
+    height = std::max(1, newHeight);
+    head.assign((size_t)width * height, -1);
+    cellOf.clear();
+    next.clear();
+    prev.clear();
+}
+
+int EnemyGrid::CellOf(const D2D_POINT_2F &p) const
+{
+    const int x = std::min(width - 1, std::max(0, (int)std::floor(p.x)));
+    const int y = std::min(height - 1, std::max(0, (int)std::floor(p.y)));
+    return y * width + x;
+}
+
+void EnemyGrid::Link(int index, int cell)
+{
+    cellOf[index] = cell;
+    prev[index] = -1;
+    next[index] = head[cell];
+    if (head[cell] >= 0)
+        prev[head[cell]] = index;
+    head[cell] = index;
+}
+
+void EnemyGrid::Unlink(int index)
+{
+    if (prev[index] >= 0)
+        next[prev[index]] = next[index];
+    else
+        head[cellOf[index]] = next[index];
+    if (next[index] >= 0)
+        prev[next[index]] = prev[index];
+}
+
+void EnemyGrid::Add(const D2D_POINT_2F &position)
+{
+    cellOf.push_back(0);
+    next.push_back(-1);
+    prev.push_back(-1);
+    Link((int)Size() - 1, CellOf(position));
+}
+
+void EnemyGrid::RemoveAt(size_t index)
+{
+    const int last = (int)Size() - 1;
+    Unlink((int)index);
+    if ((int)index != last)
+    {
+        const int cell = cellOf[last];
+        Unlink(last);
+        Link((int)index, cell);
+    }
+    cellOf.pop_back();
+    next.pop_back();
+    prev.pop_back();
+}
+
+void EnemyGrid::Update(const std::vector<D2D_POINT_2F> &positions)
+{
+    for (int i = 0; i < (int)Size(); ++i)
+    {
+        const int cell = CellOf(positions[i]);
+        if (cell == cellOf[i])
+            continue;
+        Unlink(i);
+        Link(i, cell);
+    }
+}
+
+void EnemyGrid::QueryRadius(const std::vector<D2D_POINT_2F> &positions, const D2D_POINT_2F &center, float radius,
+                            std::vector<int> &out) const
+{
+    out.clear();
+    const int x0 = std::max(0, (int)std::floor(center.x - radius));
+    const int y0 = std::max(0, (int)std::floor(center.y - radius));
+    const int x1 = std::min(width - 1, (int)std::floor(center.x + radius));
+    const int y1 = std::min(height - 1, (int)std::floor(center.y + radius));
+    const float radius2 = radius * radius;
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+            for (int i = head[y * width + x]; i >= 0; i = next[i])
+            {
+                const float dx = positions[i].x - center.x;
+                const float dy = positions[i].y - center.y;
+                if (dx * dx + dy * dy < radius2)
+                    out.push_back(i);
+            }
+}
+
+int EnemyGrid::Nearest(const std::vector<D2D_POINT_2F> &positions, const D2D_POINT_2F &center,
+                       float maxDistance) const
+{
+    const int cell = CellOf(center);
+    const int cx = cell % width;
+    const int cy = cell / width;
+    int best = -1;
+    float best2 = maxDistance * maxDistance;
+
+    // rings of tiles around the center's: the tiles of ring k are at least k - 1 away
+    for (int ring = 0; ring <= std::max(width, height); ++ring)
+    {
+        const float nearest = (float)std::max(0, ring - 1);
+        if (nearest * nearest > best2)
+            break;
+        for (int y = std::max(0, cy - ring); y <= std::min(height - 1, cy + ring); ++y)
+        {
+            // the whole row at the top and bottom of the ring, its two ends in between
+            const bool edgeRow = y == cy - ring || y == cy + ring;
+            const int step = edgeRow || ring == 0 ? 1 : 2 * ring;
+            for (int x = cx - ring; x <= cx + ring; x += step)
+            {
+                if (x < 0 || x >= width)
+                    continue;
+                for (int i = head[y * width + x]; i >= 0; i = next[i])
+                {
+                    const float dx = positions[i].x - center.x;
+                    const float dy = positions[i].y - center.y;
+                    const float d2 = dx * dx + dy * dy;
+                    if (d2 < best2 || (best < 0 && d2 == best2))
+                    {
+                        best = i;
+                        best2 = d2;
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
+
+void EnemyGrid::QueryFan(const D2D_POINT_2F &origin, const std::vector<D2D_POINT_2F> &ends, float radius,
+                         std::vector<int> &out) const
+{
+    out.clear();
+    if (ends.empty())
+        return;
+    float top = origin.y;
+    float bottom = origin.y;
+    for (const D2D_POINT_2F &end : ends)
+    {
+        top = std::min(top, end.y);
+        bottom = std::max(bottom, end.y);
+    }
+
+    // row by row, the tiles within radius across of the part of any segment that is within radius of the
+    // row, and those between them
+    const int y0 = std::max(0, (int)std::floor(top - radius));
+    const int y1 = std::min(height - 1, (int)std::floor(bottom + radius));
+    for (int y = y0; y <= y1; ++y)
+    {
+        float left = 1e30f;
+        float right = -1e30f;
+        for (const D2D_POINT_2F &end : ends)
+        {
+            const float sx = end.x - origin.x;
+            const float sy = end.y - origin.y;
+            float ta = 0.0f;
+            float tb = 1.0f;
+            if (sy != 0.0f)
+            {
+                const float enter = (y - radius - origin.y) / sy;
+                const float leave = (y + 1 + radius - origin.y) / sy;
+                ta = std::max(0.0f, std::min(enter, leave));
+                tb = std::min(1.0f, std::max(enter, leave));
+                if (ta > tb)
+                    continue;
+            }
+            else if (origin.y < y - radius || origin.y > y + 1 + radius)
+                continue;
+            const float xa = origin.x + ta * sx;
+            const float xb = origin.x + tb * sx;
+            left = std::min(left, std::min(xa, xb));
+            right = std::max(right, std::max(xa, xb));
+        }
+        if (left > right)
+            continue;
+        const int x0 = std::max(0, (int)std::floor(left - radius));
+        const int x1 = std::min(width - 1, (int)std::floor(right + radius));
+        for (int x = x0; x <= x1; ++x)
+            for (int i = head[y * width + x]; i >= 0; i = next[i])
+                out.push_back(i);
+    }
+}
+
+int EnemyGrid::QueryRay(const Map &map, const std::vector<D2D_POINT_2F> &positions, const D2D_POINT_2F &origin,
+                        const D2D_POINT_2F &dir, float radius, float &distance) const
+{
+    int best = -1;
+    distance = 1e30f;
+
+    // the tiles from x0, y0 to x1, y1 (clamped to the grid), each enemy in them tested against the ray
+    auto test = [&](int x0, int y0, int x1, int y1) {
+        x0 = std::max(0, x0);
+        y0 = std::max(0, y0);
+        x1 = std::min(width - 1, x1);
+        y1 = std::min(height - 1, y1);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                for (int i = head[y * width + x]; i >= 0; i = next[i])
+                {
+                    const float vx = positions[i].x - origin.x;
+                    const float vy = positions[i].y - origin.y;
+                    const float along = vx * dir.x + vy * dir.y;
+                    if (along <= 0.0f)
+                        continue;
+                    const float px = vx - along * dir.x;
+                    const float py = vy - along * dir.y;
+                    const float perp2 = px * px + py * py;
+                    if (perp2 >= radius * radius)
+                        continue;
+                    const float hit = along - std::sqrt(radius * radius - perp2);
+                    if (hit < distance)
+                    {
+                        distance = hit;
+                        best = i;
+                    }
+                }
+    };
+
+    // DDA as in CastRay. An enemy within radius of the ray is at most reach tiles beside a tile the ray
+    // passes, so every step adds the column or row of tiles it brings within reach. The steps only go one
+    // way in x and in y, so no tile is tested twice
+    const int reach = (int)std::ceil(radius);
+    int mapX = (int)std::floor(origin.x);
+    int mapY = (int)std::floor(origin.y);
+    const float deltaDistX = (dir.x == 0.0f) ? 1e30f : std::fabs(1.0f / dir.x);
+    const float deltaDistY = (dir.y == 0.0f) ? 1e30f : std::fabs(1.0f / dir.y);
+    const int stepX = dir.x < 0.0f ? -1 : 1;
+    const int stepY = dir.y < 0.0f ? -1 : 1;
+    float sideDistX = dir.x < 0.0f ? (origin.x - mapX) * deltaDistX : (mapX + 1.0f - origin.x) * deltaDistX;
+    float sideDistY = dir.y < 0.0f ? (origin.y - mapY) * deltaDistY : (mapY + 1.0f - origin.y) * deltaDistY;
+    test(mapX - reach, mapY - reach, mapX + reach, mapY + reach);
+
+    // an enemy first tested on entering a tile at t is hit no nearer than t - (2 reach + 1) * sqrt(2) - radius
+    const float behind = (2 * reach + 1) * 1.4143f + radius;
+    while (true)
+    {
+        float entered;
+        if (sideDistX < sideDistY)
+        {
+            entered = sideDistX;
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            test(mapX + stepX * reach, mapY - reach, mapX + stepX * reach, mapY + reach);
+        }
+        else
+        {
+            entered = sideDistY;
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            test(mapX - reach, mapY + stepY * reach, mapX + reach, mapY + stepY * reach);
+        }
+
+        if (entered - behind > distance)
+            break;
+        if (mapX < 0 || mapY < 0 || mapX >= map.width || mapY >= map.height ||
+            (map.Info(map.Tile(mapX, mapY)).flags & TileOpaque))
+        {
+            // the wall is in the way of anything farther
+            if (entered < distance)
+            {
+                distance = entered;
+                best = -1;
+            }
+            break;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include "Platform.h"
+#include "Map.h"
+
+// Enemies bucketed by the map tile their position is in, so a query looks at the enemies around it instead
+// of all of them, and costs what the enemies there are. It holds enemy places 0..Size()-1 of an EnemyStore
+// and follows the store's changes: Add after the store adds, RemoveAt before it removes, Update after the
+// enemies moved. A bucket is a list threaded through per enemy arrays, so changing tiles doesn't allocate.
+//
+// The queries that test distances take the store's positions. Positions off the map go to the bucket of
+// the nearest edge tile.
+class EnemyGrid
+{
+public:
+    // empty grid over width x height tiles
+    void Resize(int width, int height);
+    int Width() const { return width; }
+    int Height() const { return height; }
+    size_t Size() const { return cellOf.size(); }
+
+    void Add(const D2D_POINT_2F &position);
+    // like EnemyStore::RemoveAt: the last enemy takes the place of the removed one
+    void RemoveAt(size_t index);
+    // move the enemies whose position left their tile to the bucket of the new one
+    void Update(const std::vector<D2D_POINT_2F> &positions);
+
+    // the enemies closer than radius to center
+    void QueryRadius(const std::vector<D2D_POINT_2F> &positions, const D2D_POINT_2F &center, float radius,
+                     std::vector<int> &out) const;
+
+    // the enemy nearest to center, -1 if there is none within maxDistance
+    int Nearest(const std::vector<D2D_POINT_2F> &positions, const D2D_POINT_2F &center, float maxDistance) const;
+
+    // the enemies of the tiles a fan of segments from origin to each of ends passes within radius of, and
+    // of the tiles between the segments. Whole tiles, so some of them are farther: for a caller that tests
+    // them against the segments itself
+    void QueryFan(const D2D_POINT_2F &origin, const std::vector<D2D_POINT_2F> &ends, float radius,
+                  std::vector<int> &out) const;
+
+    // the enemy whose circle of radius a ray from origin along dir (unit length) enters first, -1 if it hits
+    // a wall before any. The ray walks map's tiles with the renderer's DDA and looks only at the enemies
+    // around the tiles it passes, so it costs what its length and the enemies along it are. distance is
+    // how far along the ray it hit the enemy or the wall
+    int QueryRay(const Map &map, const std::vector<D2D_POINT_2F> &positions, const D2D_POINT_2F &origin,
+                 const D2D_POINT_2F &dir, float radius, float &distance) const;
+
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<int> head; // per tile, its first enemy, -1 for none
+
+    // per enemy
+    std::vector<int> cellOf;
+    std::vector<int> next;
+    std::vector<int> prev;
+
+    int CellOf(const D2D_POINT_2F &p) const;
+    void Link(int index, int cell);
+    void Unlink(int index);
+};
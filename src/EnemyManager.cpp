@@ -1,36 +1,46 @@
 #include "EnemyManager.h"
+#include "Profiler.h"
 #include <algorithm>
 
 // constructor containing rng initialization
-EnemyManager::EnemyManager() : rng((unsigned)std::random_device{}()) {}
-EnemyManager::~EnemyManager() 
+EnemyManager::EnemyManager() : rng((unsigned)std::random_device{}())
 {
-    if (enemyBmp)
-    {
-        enemyBmp->Release(); // D2D resources use Release()
-        enemyBmp = nullptr;
-    }
+    SyncGrid();
+}
+EnemyManager::~EnemyManager() {}
+
+// size the grid to the current map, rebucketing the enemies if it changed
+void EnemyManager::SyncGrid()
+{
+    const Map &map = GetWorldMap();
+    if (grid.Width() == map.width && grid.Height() == map.height && grid.Size() == enemies.Size())
+        return;
+    grid.Resize(map.width, map.height);
+    for (const D2D_POINT_2F &p : enemies.pos)
+        grid.Add(p);
 }
 
 // Reset enemy manager state
 void EnemyManager::Reset()
 {
-    enemies.clear();
+    enemies.Clear();
+    grid.Resize(GetWorldMap().width, GetWorldMap().height);
     spawnAccumulator = 0.0f;
     spawningEnabled = true;
+    flowField.Invalidate();
 }
 
 // New: helper to find a random free floor not near player or other enemies
 bool EnemyManager::FindRandomFreeFloor(const D2D_POINT_2F &playerPos, D2D_POINT_2F &outPos)
 {
-    std::uniform_int_distribution<int> distX(1, mapWidth - 2);
-    std::uniform_int_distribution<int> distY(1, mapHeight - 2);
-
+    // mt19937 output is the same everywhere but the standard distributions aren't, so map it to tiles by hand
+    // to keep recorded sessions replayable across compilers
+    const Map &map = GetWorldMap();
     for (int attempts = 0; attempts < 200; ++attempts)
     {
-        int tx = distX(rng);
-        int ty = distY(rng);
-        if (getTile(tx, ty) != '.')
+        int tx = 1 + (int)(rng() % (uint32_t)(map.width - 2));
+        int ty = 1 + (int)(rng() % (uint32_t)(map.height - 2));
+        if (!map.Walkable(tx, ty))
             continue;
 
         D2D_POINT_2F p = {(float)tx + 0.5f, (float)ty + 0.5f};
@@ -42,9 +52,11 @@ bool EnemyManager::FindRandomFreeFloor(const D2D_POINT_2F &playerPos, D2D_POINT_
             continue; // too close (less than 3 tiles)
 
         bool occupied = false;
-        for (auto &e : enemies)
+        grid.QueryRadius(enemies.pos, p, 0.15f, nearby);
+        for (int i : nearby)
         {
-            if (std::fabs(e.pos.x - p.x) < 0.1f && std::fabs(e.pos.y - p.y) < 0.1f)
+            const D2D_POINT_2F &e = enemies.pos[i];
+            if (std::fabs(e.x - p.x) < 0.1f && std::fabs(e.y - p.y) < 0.1f)
             {
                 occupied = true;
                 break;
@@ -67,30 +79,44 @@ void EnemyManager::InitializeTargets(int count, const D2D_POINT_2F &playerPos)
         D2D_POINT_2F pos;
         if (FindRandomFreeFloor(playerPos, pos))
         {
-            enemies.emplace_back(Enemy(pos, EnemyType::Target));
+            AddEnemy(pos, EnemyType::Target);
         }
     }
 }
 
+EnemyHandle EnemyManager::AddEnemy(const D2D_POINT_2F &pos, EnemyType type, const EnemyConfig &config)
+{
+    grid.Add(pos);
+    return enemies.Add(pos, type, config);
+}
+
+void EnemyManager::RemoveAt(size_t index)
+{
+    grid.RemoveAt(index);
+    enemies.RemoveAt(index);
+}
+
 // Try to spawn a new enemy (walker)
 void EnemyManager::TrySpawn(const D2D_POINT_2F &playerPos)
 {
     if (!spawningEnabled)
         return;
 
-    if ((int)enemies.size() >= maxEnemies)
+    if ((int)enemies.Size() >= maxEnemies)
         return;
 
     D2D_POINT_2F p;
     if (FindRandomFreeFloor(playerPos, p))
     {
-        enemies.emplace_back(Enemy(p, EnemyType::Walker));
+        AddEnemy(p, EnemyType::Walker);
     }
 }
 
 // Update all enemies
 void EnemyManager::Update(float dt, const D2D_POINT_2F &playerPos)
 {
+    PROFILE_ZONE("EnemyManager::Update");
+    SyncGrid();
     spawnAccumulator += dt;
     if (spawningEnabled && spawnAccumulator >= 5.0f)
     {
@@ -98,135 +124,60 @@ void EnemyManager::Update(float dt, const D2D_POINT_2F &playerPos)
         TrySpawn(playerPos);
     }
 
-    for (auto &e : enemies)
+    // one flood from the player's tile when it changes serves every walker
+    const FlowField *flow = nullptr;
+    if (pathMode == PathMode::FlowField)
     {
-        e.Update(dt, playerPos);
-        e.TryAttack(playerPos);
+        PROFILE_ZONE("FlowField::Build");
+        flowField.Build(FindNearestWalkableAround(WorldToTile(playerPos), 3));
+        flow = &flowField;
+    }
+    ClusterGraph *clusters = nullptr;
+    if (pathMode == PathMode::Hierarchical)
+    {
+        PROFILE_ZONE("ClusterGraph::Build");
+        clusterGraph.Build(GetWorldMap());
+        clusters = &clusterGraph;
     }
-}
-
-// Create the D2D1 bitmap of the billboard renderer
-void EnemyManager::CreateBillboardRenderer(ID2D1HwndRenderTarget *rt, int width, int height)
-{
-    enemyBmpSize = D2D1::SizeU(width, height);
-    enemyBmpPx = std::vector<BYTE>(width * height * 4);
-    std::fill(enemyBmpPx.begin(), enemyBmpPx.end(), 0x00);
 
-    rt->CreateBitmap(
-        enemyBmpSize,
-        enemyBmpPx.data(), // pointer to pixel buffer
-        width * 4,         // pitch (stride in bytes)
-        &bmpProps,
-        &enemyBmp);
+    // walkers request new paths, the scheduler serves as many as the budget allows, then everyone moves
+    UpdateEnemies(enemies, dt, playerPos, flow, clusters);
+    if (!flow)
+    {
+        PROFILE_ZONE("PathScheduler::Serve");
+        pathScheduler.Serve(enemies, WorldToTile(playerPos), clusters);
+    }
+    MoveEnemies(enemies, dt, flow);
+    grid.Update(enemies.pos);
+    EnemiesAttack(enemies, playerPos);
 }
 
-// Render enemies as billboards (temporary implementation)
-void EnemyManager::RenderBillboards(ID2D1HwndRenderTarget *rt,
-                                    ID2D1SolidColorBrush *enemyBrush,
-                                    SDL_Surface *mainText,
-                                    const std::vector<float> &depthBuffer,
-                                    int width, int height,
-                                    float halfH,
-                                    const D2D_POINT_2F &playerPos,
-                                    float playerAngle,
-                                    float planeHalf)
+// Billboards of all enemies, drawn into the frame by DrawSprites
+void EnemyManager::CollectSprites(std::vector<Sprite> &out) const
 {
-    std::fill(enemyBmpPx.begin(), enemyBmpPx.end(), 0x00);
-
-    for (const auto &e : enemies)
+    for (size_t i = 0; i < enemies.Size(); ++i)
     {
-        float dxw = e.pos.x - playerPos.x;
-        float dyw = e.pos.y - playerPos.y;
-        // transform to camera space
-        float sinA = std::sin(playerAngle);
-        float cosA = std::cos(playerAngle);
-        float cx = dxw * cosA + dyw * sinA;  // forward
-        float cy = -dxw * sinA + dyw * cosA; // right
-
-        if (cx <= 0.1f)
-            continue; // behind player
-
-        float spriteScreenX = (width / 2.0f) * (1.0f + (cy / (cx * planeHalf)));
-        int spriteHeight = (int)(height / cx);
-        int spriteWidth = spriteHeight; // square
-        int drawTop = (int)(halfH - spriteHeight / 2.0f);
-        int drawBottom = (int)(halfH + spriteHeight / 2.0f);
-        int drawLeft = (int)(spriteScreenX - spriteWidth / 2.0f);
-        int drawRight = (int)(spriteScreenX + spriteWidth / 2.0f);
-
-        if (drawRight < 0 || drawLeft >= width)
-            continue;
-        if (drawTop < 0)
-            drawTop = 0;
-        if (drawBottom >= height)
-            drawBottom = height - 1;
-
-        int l = (drawLeft < 0 ? 0 : drawLeft);
-        int r = (drawRight > (width - 1) ? (width - 1) : drawRight);
-
-        D2D1_POINT_2U spritePos = D2D1::Point2U(0, 0);
-        for (int sx = l; sx <= r; ++sx)
-        {
-
-            if (cx < depthBuffer[sx])
-            {
-                int texX = int(256 * (sx - (-spriteWidth / 2 + spriteScreenX)) * 128 / spriteWidth) / 256;
-                // int texX = int(256 * (sx - (-spriteWidth / 2 + spriteScreenX)) * texWidth / spriteWidth) / 256;
-
-                for (int sy = drawTop; sy <= drawBottom; ++sy)
-                {
-                    int d = (sy) * 256 - height * 128 + spriteHeight * 128; // 256 and 128 factors to avoid floats
-                    int texY = ((d * 128) / spriteHeight) / 256;
-
-                    int currentPixel = (sy * width + sx) * 4;
-
-                    SDL_Color pixelColor;
-                    if(e.type == EnemyType::Walker)
-                        pixelColor = GetPixelColor(mainText, texX, texY + 384);
-                    else pixelColor = GetPixelColor(mainText, texX + 128, texY + 384);
-
-                    if (pixelColor.b > 0xEE && pixelColor.r > 0xEE)
-                    {
-                        continue;
-                    }
-
-                    enemyBmpPx[currentPixel + 0] = BYTE(pixelColor.b);
-                    enemyBmpPx[currentPixel + 1] = BYTE(pixelColor.g);
-                    enemyBmpPx[currentPixel + 2] = BYTE(pixelColor.r);
-                    enemyBmpPx[currentPixel + 3] = 0xFF;
-
-                    spritePos.y++;
-                }
-                spritePos.x++;
-            }
-        }
+        Sprite sprite;
+        sprite.x = enemies.pos[i].x;
+        sprite.y = enemies.pos[i].y;
+        sprite.texture = (enemies.type[i] == EnemyType::Walker) ? SpriteTexture::Walker : SpriteTexture::Target;
+        out.push_back(sprite);
     }
-
-    enemyBmp->CopyFromMemory(nullptr, enemyBmpPx.data(), width * 4);
-    rt->DrawBitmap(
-        enemyBmp,
-        D2D1::RectF(0, 0, (FLOAT)width, (FLOAT)height));
 }
 
-// Remove an enemy if its position is within 'proximity' of 'worldPos'
-bool EnemyManager::RemoveEnemyAt(const D2D_POINT_2F &worldPos, float proximity)
+bool EnemyManager::RemoveEnemy(EnemyHandle handle)
 {
-    float proximitySq = proximity * proximity;
-
-    // Use erase-remove idiom to safely remove the first enemy found
-    auto it = std::remove_if(enemies.begin(), enemies.end(),
-                             [&](const Enemy &e) {
-                                 float dx = e.pos.x - worldPos.x;
-                                 float dy = e.pos.y - worldPos.y;
-                                 return (dx * dx + dy * dy) < proximitySq;
-                             });
+    const int index = enemies.IndexOf(handle);
+    if (index < 0)
+        return false;
+    RemoveAt((size_t)index);
+    return true;
+}
 
-    if (it != enemies.end())
-    {
-        enemies.erase(it, enemies.end());
-        return true; // Enemy was removed
-    }
-    return false; // No enemy removed
+EnemyHandle EnemyManager::Hitscan(const D2D_POINT_2F &origin, const D2D_POINT_2F &dir, float &distance) const
+{
+    const int index = grid.QueryRay(GetWorldMap(), enemies.pos, origin, dir, hitRadius, distance);
+    return index < 0 ? EnemyHandle() : enemies.HandleAt((size_t)index);
 }
 
 // New: manage spawning and targets
@@ -237,17 +188,16 @@ void EnemyManager::SetSpawningEnabled(bool enabled)
 
 void EnemyManager::DestroyAllEnemies()
 {
-    enemies.clear();
-    // Also clear the billboard buffer so nothing remains drawn this frame
-    std::fill(enemyBmpPx.begin(), enemyBmpPx.end(), 0x00);
+    enemies.Clear();
+    grid.Resize(GetWorldMap().width, GetWorldMap().height);
 }
 
 int EnemyManager::CountTargets() const
 {
     int cnt = 0;
-    for (const auto &e : enemies)
+    for (EnemyType type : enemies.type)
     {
-        if (e.type == EnemyType::Target)
+        if (type == EnemyType::Target)
             ++cnt;
     }
 
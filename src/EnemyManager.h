@@ -1,37 +1,62 @@
 #pragma once
 #include <vector>
 #include <random>
-#include <d2d1.h>
+#include "Platform.h"
 #include "Enemy.h"
+#include "EnemyGrid.h"
+#include "EnemyStore.h"
+#include "FlowField.h"
+#include "PathScheduler.h"
 #include "raycastTest.h"
+#include "Sprites.h"
+
+// how walkers find their way to the player
+enum class PathMode
+{
+    AStar,        // every walker searches its own path
+    FlowField,    // one flow field from the player's tile, shared by all walkers
+    Hierarchical, // every walker routes over a graph of map clusters, refined one cluster at a time
+};
 
 class EnemyManager
 {
 public:
-    std::vector<Enemy> enemies;
+    static constexpr float hitRadius = 0.5f; // shots hit enemies within this of their center
 
     EnemyManager();
     ~EnemyManager();
 
     void Reset();
 
+    // restart the spawn position sequence, so a recorded session places enemies the same way again
+    void Seed(uint32_t seed) { rng.seed(seed); }
+
     // New: initialize stationary targets at random valid positions
     void InitializeTargets(int count, const D2D_POINT_2F &playerPos);
 
+    EnemyHandle AddEnemy(const D2D_POINT_2F &pos, EnemyType type, const EnemyConfig &config = EnemyConfig());
+
     void Update(float dt, const D2D_POINT_2F &playerPos);
-    void CreateBillboardRenderer(ID2D1HwndRenderTarget *rt, int width, int height);
-    void RenderBillboards(ID2D1HwndRenderTarget *rt,
-                          ID2D1SolidColorBrush *enemyBrush,
-                          SDL_Surface *mainText,
-                          const std::vector<float> &depthBuffer,
-                          int width, int height,
-                          float halfH,
-                          const D2D_POINT_2F &playerPos,
-                          float playerAngle,
-                          float planeHalf);
-
-    const std::vector<Enemy> &GetEnemies() const { return enemies; }
-    bool RemoveEnemyAt(const D2D_POINT_2F &worldPos, float proximity);
+
+    void SetPathMode(PathMode mode) { pathMode = mode; }
+    PathMode GetPathMode() const { return pathMode; }
+
+    // search nodes the walkers' path requests may expand per frame, 0 for no limit
+    void SetPathBudget(int nodesPerFrame) { pathScheduler.SetBudget(nodesPerFrame); }
+    const PathScheduler &GetPathScheduler() const { return pathScheduler; }
+
+    // billboards of all enemies, for DrawSprites to composite into the frame
+    void CollectSprites(std::vector<Sprite> &out) const;
+
+    const EnemyStore &GetEnemies() const { return enemies; }
+    // the enemies bucketed by tile, for queries near a point or along a ray
+    const EnemyGrid &GetGrid() const { return grid; }
+    // false if the handle's enemy is gone already
+    bool RemoveEnemy(EnemyHandle handle);
+
+    // the enemy a shot from origin along dir (unit length) hits, stopped by the first wall. A null handle if
+    // the wall comes first; distance is how far the shot went either way
+    EnemyHandle Hitscan(const D2D_POINT_2F &origin, const D2D_POINT_2F &dir, float &distance) const;
 
     // New: helpers to manage spawning and targets
     void SetSpawningEnabled(bool enabled);
@@ -39,17 +64,23 @@ public:
     int CountTargets() const;
 
 private:
+    EnemyStore enemies;
+    EnemyGrid grid; // follows every change of enemies
+    std::vector<int> nearby; // query results
+
     float spawnAccumulator = 0.0f;
     static const int maxEnemies = 20;
     std::mt19937 rng;
 
     bool spawningEnabled = true; // New: control spawn
 
-    // Sprite
-    ID2D1Bitmap *enemyBmp = NULL;
-    D2D1_SIZE_U enemyBmpSize;
-    std::vector<BYTE> enemyBmpPx;
+    PathMode pathMode = PathMode::AStar;
+    FlowField flowField; // toward the player's tile, rebuilt when it changes (PathMode::FlowField)
+    PathScheduler pathScheduler; // serves the walkers' path requests (PathMode::AStar and Hierarchical)
+    ClusterGraph clusterGraph; // of the current map, built on first use (PathMode::Hierarchical)
 
+    void SyncGrid();
+    void RemoveAt(size_t index);
     void TrySpawn(const D2D_POINT_2F &playerPos);
     bool FindRandomFreeFloor(const D2D_POINT_2F &playerPos, D2D_POINT_2F &outPos);
 };
\ No newline at end of file
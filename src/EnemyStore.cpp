@@ -0,0 +1,101 @@
+#include "EnemyStore.h"
+
+void EnemyStore::Reserve(size_t count)
+{
+    pos.reserve(count);
+    timeSinceAttack.reserve(count);
+    timeSinceRepath.reserve(count);
+    type.reserve(count);
+    pathIndex.reserve(count);
+    waypoint.reserve(count);
+    config.reserve(count);
+    path.reserve(count);
+    slotOf.reserve(count);
+    slotIndex.reserve(count);
+    slotGeneration.reserve(count);
+    freeSlots.reserve(count);
+}
+
+EnemyHandle EnemyStore::Add(const D2D_POINT_2F &position, EnemyType enemyType, const EnemyConfig &enemyConfig)
+{
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = (uint32_t)slotIndex.size();
+        slotIndex.push_back(0);
+        slotGeneration.push_back(1);
+    }
+    slotIndex[slot] = (uint32_t)Size();
+    slotOf.push_back(slot);
+
+    pos.push_back(position);
+    timeSinceAttack.push_back(0.0f);
+    timeSinceRepath.push_back(0.0f);
+    type.push_back(enemyType);
+    pathIndex.push_back(0);
+    waypoint.push_back({-1, -1});
+    config.push_back(enemyConfig);
+    path.emplace_back();
+    return {slot, slotGeneration[slot]};
+}
+
+bool EnemyStore::Remove(EnemyHandle handle)
+{
+    const int index = IndexOf(handle);
+    if (index < 0)
+        return false;
+    RemoveAt((size_t)index);
+    return true;
+}
+
+void EnemyStore::RemoveAt(size_t index)
+{
+    // retire the slot; generation 0 is skipped when it wraps, so a default handle never matches
+    const uint32_t slot = slotOf[index];
+    if (++slotGeneration[slot] == 0)
+        slotGeneration[slot] = 1;
+    freeSlots.push_back(slot);
+
+    // move the last enemy into the gap
+    const size_t last = Size() - 1;
+    if (index != last)
+    {
+        pos[index] = pos[last];
+        timeSinceAttack[index] = timeSinceAttack[last];
+        timeSinceRepath[index] = timeSinceRepath[last];
+        type[index] = type[last];
+        pathIndex[index] = pathIndex[last];
+        waypoint[index] = waypoint[last];
+        config[index] = config[last];
+        path[index] = std::move(path[last]);
+        slotOf[index] = slotOf[last];
+        slotIndex[slotOf[index]] = (uint32_t)index;
+    }
+    pos.pop_back();
+    timeSinceAttack.pop_back();
+    timeSinceRepath.pop_back();
+    type.pop_back();
+    pathIndex.pop_back();
+    waypoint.pop_back();
+    config.pop_back();
+    path.pop_back();
+    slotOf.pop_back();
+}
+
+void EnemyStore::Clear()
+{
+    while (!Empty())
+        RemoveAt(Size() - 1);
+}
+
+int EnemyStore::IndexOf(EnemyHandle handle) const
+{
+    if (handle.slot >= slotGeneration.size() || slotGeneration[handle.slot] != handle.generation)
+        return -1;
+    return (int)slotIndex[handle.slot];
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Enemy.h"
+
+// Refers to one enemy of an EnemyStore. It finds the enemy wherever removals move it, and never refers to
+// another enemy once it is removed, even when its slot is reused
+struct EnemyHandle
+{
+    uint32_t slot = 0;
+    uint32_t generation = 0; // 0 never refers to an enemy
+
+    bool operator==(const EnemyHandle &o) const { return slot == o.slot && generation == o.generation; }
+    bool operator!=(const EnemyHandle &o) const { return !(*this == o); }
+};
+
+// All enemies as a structure of arrays: every field is its own array, indexed by the enemy's place
+// 0..Size()-1, so a loop over some fields reads only those. Config and path following state, which owns
+// heap memory, are arrays of their own too.
+//
+// Removing an enemy moves the last one into its place, so removal is O(1) and the order of the enemies
+// changes. Keep a handle, not an index, to refer to an enemy across removals.
+class EnemyStore
+{
+public:
+    std::vector<D2D_POINT_2F> pos;
+    std::vector<float> timeSinceAttack;
+    std::vector<float> timeSinceRepath;
+    std::vector<EnemyType> type;
+    std::vector<int> pathIndex; // the tile of path[i].tiles walked to
+    std::vector<IPoint> waypoint; // flow field following: the tile center walked to, {-1,-1} for none yet
+    std::vector<EnemyConfig> config;
+    std::vector<EnemyPath> path;
+
+    size_t Size() const { return pos.size(); }
+    bool Empty() const { return pos.empty(); }
+
+    // make room for count enemies, so adding up to that many doesn't allocate but for their paths
+    void Reserve(size_t count);
+
+    EnemyHandle Add(const D2D_POINT_2F &position, EnemyType enemyType, const EnemyConfig &enemyConfig = EnemyConfig());
+
+    // false if the handle's enemy was removed already
+    bool Remove(EnemyHandle handle);
+    void RemoveAt(size_t index);
+    void Clear();
+
+    // the place of the handle's enemy, -1 if it was removed
+    int IndexOf(EnemyHandle handle) const;
+    EnemyHandle HandleAt(size_t index) const { return {slotOf[index], slotGeneration[slotOf[index]]}; }
+
+private:
+    std::vector<uint32_t> slotOf;         // per enemy, its slot
+    std::vector<uint32_t> slotIndex;      // per slot, the place of its enemy
+    std::vector<uint32_t> slotGeneration; // per slot, bumped when its enemy is removed
+    std::vector<uint32_t> freeSlots;
+};
@@ -0,0 +1,251 @@
+#include "Floor.h"
+#include <algorithm>
+#include <cmath>
+
+// one floor row and its mirrored ceiling row. Texture coordinates are 16.16 fixed point in texels of the
+// full size tile and wrap around at 2^32, which keeps the texel bits right for any world position
+struct FloorRow
+{
+    uint32_t u = 0; // texture coordinates at the first pixel
+    uint32_t v = 0;
+    uint32_t du = 0; // per pixel step
+    uint32_t dv = 0;
+    int shift = 16;   // right shift from a coordinate to a texel of the mip level
+    int sizeShift = 0; // log2 of the level's size, to step between its columns
+    uint32_t mask = 0;  // level size - 1
+    const uint32_t *floorTexels = nullptr;
+    const uint32_t *ceilingTexels = nullptr;
+    int y = 0;  // floor row
+    int yc = 0; // ceiling row
+};
+
+static inline uint32_t TexelIndex(const FloorRow &row, uint32_t u, uint32_t v)
+{
+    return (((u >> row.shift) & row.mask) << row.sizeShift) | ((v >> row.shift) & row.mask);
+}
+
+static void FloorRowScalar(const FloorRow &row, const ColumnSpan *spans, uint32_t *floorPixels, uint32_t *ceilingPixels,
+                           int x0, int x1)
+{
+    uint32_t u = row.u;
+    uint32_t v = row.v;
+    for (int x = x0; x < x1; ++x, u += row.du, v += row.dv)
+    {
+        const uint32_t index = TexelIndex(row, u, v);
+        if (row.y >= spans[x].bottom)
+            floorPixels[x] = 0xFF000000 | row.floorTexels[index];
+        if (row.yc < spans[x].top)
+            ceilingPixels[x] = 0xFF000000 | row.ceilingTexels[index];
+    }
+}
+
+#if RAYCORE_X86
+
+static void FloorRowSSE2(const FloorRow &row, const ColumnSpan *spans, uint32_t *floorPixels, uint32_t *ceilingPixels,
+                         int x0, int x1)
+{
+    const __m128i shift = _mm_cvtsi32_si128(row.shift);
+    const __m128i sizeShift = _mm_cvtsi32_si128(row.sizeShift);
+    const __m128i mask = _mm_set1_epi32((int)row.mask);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    const __m128i floorY = _mm_set1_epi32(row.y + 1);
+    const __m128i ceilingY = _mm_set1_epi32(row.yc);
+    const __m128i du4 = _mm_set1_epi32((int)(row.du * 4));
+    const __m128i dv4 = _mm_set1_epi32((int)(row.dv * 4));
+
+    __m128i u = _mm_setr_epi32((int)row.u, (int)(row.u + row.du), (int)(row.u + 2 * row.du), (int)(row.u + 3 * row.du));
+    __m128i v = _mm_setr_epi32((int)row.v, (int)(row.v + row.dv), (int)(row.v + 2 * row.dv), (int)(row.v + 3 * row.dv));
+
+    int x = x0;
+    alignas(16) uint32_t index[4];
+    for (; x + 4 <= x1; x += 4)
+    {
+        // split four spans into their tops and bottoms
+        const __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&spans[x]));
+        const __m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&spans[x + 2]));
+        const __m128i tops = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i bottoms = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        const __m128i floorMask = _mm_cmpgt_epi32(floorY, bottoms);
+        const __m128i ceilingMask = _mm_cmpgt_epi32(tops, ceilingY);
+
+        if (_mm_movemask_epi8(_mm_or_si128(floorMask, ceilingMask)))
+        {
+            const __m128i tx = _mm_and_si128(_mm_srl_epi32(u, shift), mask);
+            const __m128i ty = _mm_and_si128(_mm_srl_epi32(v, shift), mask);
+            _mm_store_si128((__m128i *)index, _mm_or_si128(_mm_sll_epi32(tx, sizeShift), ty));
+
+            // no gather before AVX2, so the texels are loaded one by one
+            const uint32_t *f = row.floorTexels;
+            const uint32_t *c = row.ceilingTexels;
+            const __m128i floorTexels = _mm_or_si128(alpha, _mm_setr_epi32((int)f[index[0]], (int)f[index[1]], (int)f[index[2]], (int)f[index[3]]));
+            const __m128i ceilingTexels = _mm_or_si128(alpha, _mm_setr_epi32((int)c[index[0]], (int)c[index[1]], (int)c[index[2]], (int)c[index[3]]));
+
+            __m128i *floorDst = (__m128i *)&floorPixels[x];
+            __m128i *ceilingDst = (__m128i *)&ceilingPixels[x];
+            _mm_storeu_si128(floorDst, _mm_or_si128(_mm_and_si128(floorMask, floorTexels), _mm_andnot_si128(floorMask, _mm_loadu_si128(floorDst))));
+            _mm_storeu_si128(ceilingDst, _mm_or_si128(_mm_and_si128(ceilingMask, ceilingTexels), _mm_andnot_si128(ceilingMask, _mm_loadu_si128(ceilingDst))));
+        }
+
+        u = _mm_add_epi32(u, du4);
+        v = _mm_add_epi32(v, dv4);
+    }
+
+    FloorRow tail = row;
+    tail.u = row.u + (uint32_t)(x - x0) * row.du;
+    tail.v = row.v + (uint32_t)(x - x0) * row.dv;
+    FloorRowScalar(tail, spans, floorPixels, ceilingPixels, x, x1);
+}
+
+RAYCORE_TARGET_AVX2
+static void FloorRowAVX2(const FloorRow &row, const ColumnSpan *spans, uint32_t *floorPixels, uint32_t *ceilingPixels,
+                         int x0, int x1)
+{
+    const __m128i shift = _mm_cvtsi32_si128(row.shift);
+    const __m128i sizeShift = _mm_cvtsi32_si128(row.sizeShift);
+    const __m256i mask = _mm256_set1_epi32((int)row.mask);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    const __m256i floorY = _mm256_set1_epi32(row.y + 1);
+    const __m256i ceilingY = _mm256_set1_epi32(row.yc);
+    const __m256i du8 = _mm256_set1_epi32((int)(row.du * 8));
+    const __m256i dv8 = _mm256_set1_epi32((int)(row.dv * 8));
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i spanOrder = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7); // tops of four spans, then bottoms
+
+    __m256i u = _mm256_add_epi32(_mm256_set1_epi32((int)row.u), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)row.du)));
+    __m256i v = _mm256_add_epi32(_mm256_set1_epi32((int)row.v), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)row.dv)));
+
+    int x = x0;
+    for (; x + 8 <= x1; x += 8)
+    {
+        const __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&spans[x]), spanOrder);
+        const __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&spans[x + 4]), spanOrder);
+        const __m256i tops = _mm256_permute2x128_si256(a, b, 0x20);
+        const __m256i bottoms = _mm256_permute2x128_si256(a, b, 0x31);
+        const __m256i floorMask = _mm256_cmpgt_epi32(floorY, bottoms);
+        const __m256i ceilingMask = _mm256_cmpgt_epi32(tops, ceilingY);
+        const int floorBits = _mm256_movemask_ps(_mm256_castsi256_ps(floorMask));
+        const int ceilingBits = _mm256_movemask_ps(_mm256_castsi256_ps(ceilingMask));
+
+        if (floorBits | ceilingBits)
+        {
+            const __m256i tx = _mm256_and_si256(_mm256_srl_epi32(u, shift), mask);
+            const __m256i ty = _mm256_and_si256(_mm256_srl_epi32(v, shift), mask);
+            const __m256i index = _mm256_or_si256(_mm256_sll_epi32(tx, sizeShift), ty);
+
+            // masked gathers and stores, so pixels covered by a wall are neither read nor written. Most of the
+            // floor is below every wall though, where a plain gather and store is cheaper
+            if (floorBits == 0xFF)
+            {
+                __m256i texels = _mm256_i32gather_epi32((const int *)row.floorTexels, index, 4);
+                _mm256_storeu_si256((__m256i *)&floorPixels[x], _mm256_or_si256(alpha, texels));
+            }
+            else if (floorBits)
+            {
+                __m256i texels = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)row.floorTexels, index, floorMask, 4);
+                _mm256_maskstore_epi32((int *)&floorPixels[x], floorMask, _mm256_or_si256(alpha, texels));
+            }
+
+            if (ceilingBits == 0xFF)
+            {
+                __m256i texels = _mm256_i32gather_epi32((const int *)row.ceilingTexels, index, 4);
+                _mm256_storeu_si256((__m256i *)&ceilingPixels[x], _mm256_or_si256(alpha, texels));
+            }
+            else if (ceilingBits)
+            {
+                __m256i texels = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)row.ceilingTexels, index, ceilingMask, 4);
+                _mm256_maskstore_epi32((int *)&ceilingPixels[x], ceilingMask, _mm256_or_si256(alpha, texels));
+            }
+        }
+
+        u = _mm256_add_epi32(u, du8);
+        v = _mm256_add_epi32(v, dv8);
+    }
+
+    FloorRow tail = row;
+    tail.u = row.u + (uint32_t)(x - x0) * row.du;
+    tail.v = row.v + (uint32_t)(x - x0) * row.dv;
+    FloorRowScalar(tail, spans, floorPixels, ceilingPixels, x, x1);
+}
+
+#endif
+
+// 16.16 fixed point coordinate of a position in texels, wrapped to 32 bits
+static inline uint32_t ToFixed(double texels)
+{
+    return (uint32_t)(int64_t)std::floor(texels * 65536.0);
+}
+
+void CastFloorColumns(const RayBasis &basis, const TextureAtlas &atlas, int floorTile, int ceilingTile,
+                      bool mipmaps, Framebuffer &fb, int x0, int x1, SimdLevel level)
+{
+    const int size = atlas.tileSize;
+    if (size <= 0 || (size & (size - 1)) != 0)
+        return;
+    int sizeShift = 0;
+    while ((1 << sizeShift) < size)
+        ++sizeShift;
+
+    const int width = fb.width;
+    const int height = fb.height;
+    level = ClampSimdLevel(level);
+
+    // rays through the left and right screen edge, as CastRay computes them for camX -1 and 1
+    const double leftX = basis.cosA + basis.planeHalf * basis.sinA;
+    const double leftY = basis.sinA - basis.planeHalf * basis.cosA;
+    const double rightX = basis.cosA - basis.planeHalf * basis.sinA;
+    const double rightY = basis.sinA + basis.planeHalf * basis.cosA;
+
+    // the camera is half a wall above the floor. A wall 1 tile away spans height pixels, so the floor
+    // seen through the centre of row y is posZ / (distance of the row from the horizon) tiles away
+    const double posZ = 0.5 * height;
+
+    for (int y = (height + 1) / 2; y < height; ++y)
+    {
+        const double p = y + 0.5 - posZ;
+        const double rowDistance = posZ / p;
+        const double stepX = rowDistance * (rightX - leftX) / width;
+        const double stepY = rowDistance * (rightY - leftY) / width;
+        const double startX = basis.posX + rowDistance * leftX;
+        const double startY = basis.posY + rowDistance * leftY;
+
+        // mip level from the texels a pixel covers along the row or towards the horizon, whichever is more
+        int mip = 0;
+        if (mipmaps)
+        {
+            const double texelsPerPixel = size * std::max(std::sqrt(stepX * stepX + stepY * stepY), rowDistance / p);
+            while (mip + 1 < atlas.levelCount && texelsPerPixel >= (double)(2 << mip))
+                ++mip;
+        }
+
+        // stepped from column 0 in fixed point, so the texels don't depend on how the screen is split into bands
+        FloorRow row;
+        row.du = (uint32_t)(int32_t)std::lround(stepX * size * 65536.0);
+        row.dv = (uint32_t)(int32_t)std::lround(stepY * size * 65536.0);
+        row.u = ToFixed(startX * size) + (uint32_t)x0 * row.du;
+        row.v = ToFixed(startY * size) + (uint32_t)x0 * row.dv;
+        row.shift = 16 + mip;
+        row.sizeShift = sizeShift - mip;
+        row.mask = (uint32_t)atlas.LevelSize(mip) - 1;
+        row.floorTexels = atlas.Column(floorTile, 0, mip);
+        row.ceilingTexels = atlas.Column(ceilingTile, 0, mip);
+        row.y = y;
+        row.yc = height - 1 - y;
+
+        uint32_t *floorPixels = fb.Row(row.y);
+        uint32_t *ceilingPixels = fb.Row(row.yc);
+        switch (level)
+        {
+#if RAYCORE_X86
+        case SimdLevel::AVX2:
+            FloorRowAVX2(row, fb.spans.data(), floorPixels, ceilingPixels, x0, x1);
+            break;
+        case SimdLevel::SSE2:
+            FloorRowSSE2(row, fb.spans.data(), floorPixels, ceilingPixels, x0, x1);
+            break;
+#endif
+        default:
+            FloorRowScalar(row, fb.spans.data(), floorPixels, ceilingPixels, x0, x1);
+            break;
+        }
+    }
+}
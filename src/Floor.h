@@ -0,0 +1,10 @@
+#pragma once
+
+#include "Raycaster.h"
+
+// draw the textured floor and ceiling of columns [x0, x1) into fb.Pixels(), on every pixel below or above
+// the column's wall span in fb.spans. Every row of the floor lies at one distance from the camera, so its
+// texture coordinates step linearly along the row and are computed 4 (SSE2) or 8 (AVX2) pixels at a time.
+// The atlas tiles must be a power of two in size.
+void CastFloorColumns(const RayBasis &basis, const TextureAtlas &atlas, int floorTile, int ceilingTile,
+                      bool mipmaps, Framebuffer &fb, int x0, int x1, SimdLevel level);
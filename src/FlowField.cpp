@@ -0,0 +1,99 @@
+#include "FlowField.h"
+#include <algorithm>
+
+// neighbour offsets, in the order AStarTilePath expands them
+static const int DX[4] = {1, -1, 0, 0};
+static const int DY[4] = {0, 0, 1, -1};
+
+static const uint8_t noDirection = 0xFF;
+static const uint8_t atGoal = 4;
+
+int FlowField::Index(int x, int y) const
+{
+    x -= originX;
+    y -= originY;
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return -1;
+    return y * width + x;
+}
+
+void FlowField::Build(const IPoint &newGoal, int newRadius)
+{
+    const Map &current = GetWorldMap();
+    newRadius = std::max(1, std::min(newRadius, 0xFFFE));
+    if (built && map == &current && goal == newGoal && radius == newRadius)
+        return;
+
+    built = true;
+    map = &current;
+    goal = newGoal;
+    radius = newRadius;
+
+    // the window of tiles within radius of the goal, clipped to the map
+    originX = std::max(0, goal.x - radius);
+    originY = std::max(0, goal.y - radius);
+    width = std::max(0, std::min(current.width, goal.x + radius + 1) - originX);
+    height = std::max(0, std::min(current.height, goal.y + radius + 1) - originY);
+
+    // the arrays only ever grow, so a moving goal doesn't allocate
+    const size_t tiles = (size_t)width * height;
+    if (directions.size() < tiles)
+    {
+        directions.resize(tiles);
+        distances.resize(tiles);
+        queue.resize(tiles);
+    }
+    std::fill(directions.begin(), directions.begin() + tiles, noDirection);
+
+    const int goalIndex = Index(goal.x, goal.y);
+    if (goalIndex < 0 || !IsWalkable(goal.x, goal.y))
+        return;
+
+    // breadth-first from the goal: every tile points back at the tile it was reached from
+    directions[goalIndex] = atGoal;
+    distances[goalIndex] = 0;
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = goalIndex;
+    while (head < tail)
+    {
+        const int index = queue[head++];
+        const int distance = distances[index];
+        if (distance >= radius)
+            continue;
+
+        const int x = originX + index % width;
+        const int y = originY + index / width;
+        for (int i = 0; i < 4; ++i)
+        {
+            const int nx = x + DX[i];
+            const int ny = y + DY[i];
+            const int nIndex = Index(nx, ny);
+            if (nIndex < 0 || directions[nIndex] != noDirection || !current.Walkable(nx, ny))
+                continue;
+
+            directions[nIndex] = (uint8_t)(i ^ 1); // the opposite offset leads back
+            distances[nIndex] = (uint16_t)(distance + 1);
+            queue[tail++] = nIndex;
+        }
+    }
+}
+
+bool FlowField::Next(const IPoint &tile, IPoint &next) const
+{
+    const int index = built ? Index(tile.x, tile.y) : -1;
+    if (index < 0 || directions[index] >= atGoal)
+        return false;
+
+    const int d = directions[index];
+    next = {tile.x + DX[d], tile.y + DY[d]};
+    return true;
+}
+
+int FlowField::Distance(const IPoint &tile) const
+{
+    const int index = built ? Index(tile.x, tile.y) : -1;
+    if (index < 0 || directions[index] == noDirection)
+        return -1;
+    return distances[index];
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Pathfinding.h"
+
+// Dijkstra map toward one goal tile, shared by every walker: a breadth-first flood from the goal leaves each
+// tile it reaches the neighbour that is one step closer, so any number of walkers follow it in O(1) a step.
+//
+// The flood covers the tiles within radius steps of the goal (all of the built-in map), so rebuilding it
+// costs the same on any size of map. Walkers further away than that have no direction.
+class FlowField
+{
+public:
+    static const int defaultRadius = 128;
+
+    // flood the current map from goal, unless the field already leads there
+    void Build(const IPoint &goal, int radius = defaultRadius);
+
+    // forget the goal, so the next Build floods again (e.g. after the map changed)
+    void Invalidate() { built = false; }
+
+    // the neighbour of tile one step closer to the goal. False at the goal itself and on tiles the flood
+    // didn't reach
+    bool Next(const IPoint &tile, IPoint &next) const;
+
+    // steps from tile to the goal, -1 if the flood didn't reach it
+    int Distance(const IPoint &tile) const;
+
+    bool IsBuilt() const { return built; }
+    const IPoint &Goal() const { return goal; }
+
+private:
+    // index into the field's window of the map, -1 outside it
+    int Index(int x, int y) const;
+
+    bool built = false;
+    const Map *map = nullptr;
+    IPoint goal;
+    int radius = 0;
+
+    // the window of the map around the goal the flood can reach
+    int originX = 0;
+    int originY = 0;
+    int width = 0;
+    int height = 0;
+
+    std::vector<uint8_t> directions; // per window tile: index into the neighbour offsets, noDirection if unreached
+    std::vector<uint16_t> distances;
+    std::vector<int> queue;
+};
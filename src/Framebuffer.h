@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// memory layout the walls are drawn in
+enum class FramebufferLayout
+{
+    RowMajor,       // straight into pixels, one row stride per pixel down a column
+    ColumnMajor,    // into the column buffer, then transposed into pixels
+    IndexedColumns, // 8-bit palette indices into the index buffer, then expanded into pixels
+};
+
+// rows [top, bottom) of a screen column that hold wall pixels
+struct ColumnSpan
+{
+    int top = 0;
+    int bottom = 0;
+};
+
+// timings of the last RenderFrame call, in milliseconds of CPU time summed over all threads
+struct RenderStats
+{
+    double wallMs = 0.0;
+    double transposeMs = 0.0;
+    double floorMs = 0.0;
+    uint64_t texelFetches = 0; // wall texels read
+    uint64_t texelLines = 0;   // 64 byte texture cache lines those reads touched, counted per column
+};
+
+// a sprite's screen rectangle, clipped to the frame
+struct ProjectedSprite
+{
+    float distance = 0.0f; // along the view direction
+    float screenX = 0.0f;
+    int size = 0; // height and width on screen before clipping
+    int top = 0, bottom = 0; // rows [top, bottom]
+    int left = 0, right = 0; // columns [left, right]
+    bool needsDepthTest = true;
+    int tile = 0;
+    uint32_t order = 0; // index in the sprite list, to break ties
+};
+
+// min/max pyramid over the per-column wall depth: level k holds the nearest and farthest wall of every
+// block of 2^k columns, so a whole range of columns can be tested against a distance in O(log width)
+struct DepthPyramid
+{
+    int width = 0;
+    int levels = 0;
+    std::vector<size_t> levelOffsets; // first node of every level in minDepth/maxDepth
+    std::vector<float> minDepth;
+    std::vector<float> maxDepth;
+
+    void Build(const float *depth, int depthWidth)
+    {
+        width = depthWidth;
+        levelOffsets.clear();
+        size_t size = 0;
+        for (int n = width; ; n = (n + 1) / 2)
+        {
+            levelOffsets.push_back(size);
+            size += n;
+            if (n <= 1)
+                break;
+        }
+        levels = (int)levelOffsets.size();
+        minDepth.resize(size);
+        maxDepth.resize(size);
+
+        std::copy(depth, depth + width, minDepth.begin());
+        std::copy(depth, depth + width, maxDepth.begin());
+        for (int level = 1; level < levels; ++level)
+        {
+            const size_t child = levelOffsets[level - 1];
+            const size_t parent = levelOffsets[level];
+            const int childCount = LevelWidth(level - 1);
+            for (int i = 0; i < LevelWidth(level); ++i)
+            {
+                const int a = 2 * i;
+                const int b = a + 1 < childCount ? a + 1 : a;
+                minDepth[parent + i] = std::min(minDepth[child + a], minDepth[child + b]);
+                maxDepth[parent + i] = std::max(maxDepth[child + a], maxDepth[child + b]);
+            }
+        }
+    }
+
+    int LevelWidth(int level) const { return (width + (1 << level) - 1) >> level; }
+
+    // nearest and farthest wall over columns [x0, x1]
+    void Range(int x0, int x1, float &nearest, float &farthest) const
+    {
+        nearest = 1e30f;
+        farthest = 0.0f;
+        for (int level = 0; x0 <= x1; ++level, x0 >>= 1, x1 >>= 1)
+        {
+            const size_t base = levelOffsets[level];
+            if (x0 & 1)
+            {
+                nearest = std::min(nearest, minDepth[base + x0]);
+                farthest = std::max(farthest, maxDepth[base + x0]);
+                ++x0;
+            }
+            if (!(x1 & 1))
+            {
+                nearest = std::min(nearest, minDepth[base + x1]);
+                farthest = std::max(farthest, maxDepth[base + x1]);
+                --x1;
+            }
+        }
+    }
+
+    // first column >= x whose wall is farther than distance, skipping whole blocks of nearer walls.
+    // Returns a column >= width when there is none
+    int NextVisible(int x, float distance) const
+    {
+        while (x < width)
+        {
+            if (maxDepth[x] > distance)
+                return x;
+            // climb while the block starting at x is still aligned and hidden as a whole
+            int level = 0;
+            while (level + 1 < levels && !(x & ((2 << level) - 1)) &&
+                   maxDepth[levelOffsets[level + 1] + (x >> (level + 1))] <= distance)
+                ++level;
+            x += 1 << level;
+        }
+        return x;
+    }
+};
+
+// CPU side frame the raycaster renders into
+struct Framebuffer
+{
+    int width = 0;
+    int height = 0;
+
+    // row-major BGRA (0xAARRGGBB) through Pixels(), alpha 0 where no wall was drawn. Every row starts on a
+    // cache line; pitch is the width rounded up to whole cache lines, so bands of columns a multiple of a
+    // cache line wide never share one
+    size_t pitch = 0;
+    std::vector<uint32_t> pixelStorage;
+
+    // perpendicular wall distance per screen column through Depth(), starting on a cache line
+    std::vector<float> depthStorage;
+
+    // column-major copy of the frame the walls are drawn into, so walking down a column is sequential.
+    // Every column starts on a cache line; columnPitch is the height rounded up to whole cache lines.
+    size_t columnPitch = 0;
+    std::vector<uint32_t> columnStorage;
+
+    // the same for the palette indices of the indexed layout, one byte per pixel
+    size_t indexPitch = 0;
+    std::vector<uint8_t> indexStorage;
+
+    // wall span each column got last frame, in the buffer of spanLayout. Everything outside it is still
+    // clear, so the next frame only has to clear what the new span doesn't cover again
+    std::vector<ColumnSpan> spans;
+    FramebufferLayout spanLayout = FramebufferLayout::ColumnMajor;
+    bool floorDrawn = false; // pixels outside the spans hold a textured floor and ceiling instead of 0
+
+    // rows [dirtyTop, dirtyBottom) of pixels changed since the last ClearDirtyRows, so a presenter only
+    // has to upload those
+    int dirtyTop = 0;
+    int dirtyBottom = 0;
+
+    DepthPyramid depthPyramid; // over depth, rebuilt by the sprite pass
+
+    // scratch of RenderFrame and DrawSprites, kept from frame to frame so drawing one doesn't allocate
+    std::vector<ColumnSpan> bandDirty;           // rows each band of columns changed
+    std::vector<RenderStats> bandStats;          // and its timings
+    std::vector<ProjectedSprite> visibleSprites; // the sprites left after culling, in drawing order
+
+    void MarkDirtyRows(int top, int bottom)
+    {
+        if (top >= bottom)
+            return;
+        if (dirtyTop >= dirtyBottom)
+        {
+            dirtyTop = top;
+            dirtyBottom = bottom;
+            return;
+        }
+        dirtyTop = top < dirtyTop ? top : dirtyTop;
+        dirtyBottom = bottom > dirtyBottom ? bottom : dirtyBottom;
+    }
+    void ClearDirtyRows() { dirtyTop = dirtyBottom = 0; }
+
+    uint32_t *Pixels() { return (uint32_t *)AlignToLine(pixelStorage.data()); }
+    const uint32_t *Pixels() const { return const_cast<Framebuffer *>(this)->Pixels(); }
+    uint32_t *Row(int y) { return Pixels() + y * pitch; }
+    float *Depth() { return (float *)AlignToLine(depthStorage.data()); }
+    const float *Depth() const { return const_cast<Framebuffer *>(this)->Depth(); }
+
+    uint32_t *Column(int x) { return ColumnBase() + x * columnPitch; }
+    const uint32_t *Column(int x) const { return const_cast<Framebuffer *>(this)->Column(x); }
+    uint8_t *IndexColumn(int x) { return (uint8_t *)AlignToLine(indexStorage.data()) + x * indexPitch; }
+
+    void Resize(int w, int h)
+    {
+        if (w == width && h == height)
+            return;
+        width = w;
+        height = h;
+        pitch = ((size_t)w + cacheLinePixels - 1) & ~(size_t)(cacheLinePixels - 1);
+        pixelStorage.assign(pitch * h + cacheLinePixels, 0);
+        depthStorage.assign((size_t)w + cacheLinePixels, 1e30f);
+
+        columnPitch = ((size_t)h + cacheLinePixels - 1) & ~(size_t)(cacheLinePixels - 1);
+        columnStorage.assign(columnPitch * w + cacheLinePixels, 0);
+        indexPitch = ((size_t)h + 63) & ~(size_t)63;
+        indexStorage.assign(indexPitch * w + 64, 0);
+        spans.assign(w, ColumnSpan());
+        MarkDirtyRows(0, h);
+    }
+
+    static const int cacheLinePixels = 64 / sizeof(uint32_t);
+
+private:
+    static void *AlignToLine(void *p) { return (void *)(((uintptr_t)p + 63) & ~(uintptr_t)63); }
+    uint32_t *ColumnBase() { return (uint32_t *)AlignToLine(columnStorage.data()); }
+};
@@ -0,0 +1,151 @@
+#include "InputLog.h"
+#include <algorithm>
+#include <cstring>
+
+static const char logMagic[4] = {'R', 'C', 'I', 'N'};
+static const uint32_t logVersion = 3; // 2 added the weapon and the path mode, 3 the level
+
+// little-endian fields, so logs move between machines
+static void PutU32(uint8_t *out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        out[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t GetU32(const uint8_t *in)
+{
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static uint32_t FloatBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    return bits;
+}
+
+static float BitsFloat(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+static const int headerSize = 56;   // then the map path
+static const uint32_t maxMapPath = 4096;
+static const int frameSize = 9;
+
+bool InputRecorder::Open(const char *path, uint32_t seed, int width, int height, const WeaponConfig &weapon,
+                         PathMode pathMode, const char *mapPath, const Map &map)
+{
+    Close();
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not create %s\n", path);
+        return false;
+    }
+
+    uint8_t header[headerSize];
+    memcpy(header, logMagic, 4);
+    PutU32(header + 4, logVersion);
+    PutU32(header + 8, seed);
+    PutU32(header + 12, (uint32_t)width);
+    PutU32(header + 16, (uint32_t)height);
+    PutU32(header + 20, (uint32_t)weapon.pellets);
+    PutU32(header + 24, FloatBits(weapon.spread));
+    PutU32(header + 28, FloatBits(weapon.fireInterval));
+    PutU32(header + 32, (uint32_t)pathMode);
+    const uint64_t checksum = MapChecksum(map);
+    const uint32_t pathLength = mapPath ? (uint32_t)std::min(strlen(mapPath), (size_t)maxMapPath) : 0;
+    PutU32(header + 36, (uint32_t)map.width);
+    PutU32(header + 40, (uint32_t)map.height);
+    PutU32(header + 44, (uint32_t)checksum);
+    PutU32(header + 48, (uint32_t)(checksum >> 32));
+    PutU32(header + 52, pathLength);
+    fwrite(header, 1, headerSize, file);
+    if (pathLength)
+        fwrite(mapPath, 1, pathLength, file);
+    return true;
+}
+
+void InputRecorder::Write(const FrameInput &input)
+{
+    if (!file)
+        return;
+    uint8_t record[frameSize];
+    PutU32(record, FloatBits(input.dt));
+    PutU32(record + 4, FloatBits(input.mouseDx));
+    record[8] = input.buttons;
+    fwrite(record, 1, frameSize, file);
+}
+
+void InputRecorder::Close()
+{
+    if (file)
+        fclose(file);
+    file = nullptr;
+}
+
+bool InputLog::Load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+
+    uint8_t header[headerSize];
+    if (fread(header, 1, 8, file) != 8 || memcmp(header, logMagic, 4) != 0)
+    {
+        fprintf(stderr, "%s is not an input log\n", path);
+        fclose(file);
+        return false;
+    }
+    if (GetU32(header + 4) != logVersion)
+    {
+        fprintf(stderr, "%s is an input log of version %u, this build replays version %u\n", path,
+                GetU32(header + 4), logVersion);
+        fclose(file);
+        return false;
+    }
+    if (fread(header + 8, 1, headerSize - 8, file) != headerSize - 8 ||
+        GetU32(header + 32) > (uint32_t)PathMode::Hierarchical || GetU32(header + 52) > maxMapPath)
+    {
+        fprintf(stderr, "%s is not an input log\n", path);
+        fclose(file);
+        return false;
+    }
+    seed = GetU32(header + 8);
+    width = (int)GetU32(header + 12);
+    height = (int)GetU32(header + 16);
+    weapon.pellets = (int)GetU32(header + 20);
+    weapon.spread = BitsFloat(GetU32(header + 24));
+    weapon.fireInterval = BitsFloat(GetU32(header + 28));
+    pathMode = (PathMode)GetU32(header + 32);
+    mapWidth = (int)GetU32(header + 36);
+    mapHeight = (int)GetU32(header + 40);
+    mapChecksum = GetU32(header + 44) | (uint64_t)GetU32(header + 48) << 32;
+    mapPath.assign(GetU32(header + 52), '\0');
+    if (!mapPath.empty() && fread(&mapPath[0], 1, mapPath.size(), file) != mapPath.size())
+    {
+        fprintf(stderr, "%s is not an input log\n", path);
+        fclose(file);
+        return false;
+    }
+
+    // a log cut short by a crash still replays up to its last whole frame
+    frames.clear();
+    uint8_t record[frameSize];
+    while (fread(record, 1, frameSize, file) == frameSize)
+    {
+        FrameInput input;
+        input.dt = BitsFloat(GetU32(record));
+        input.mouseDx = BitsFloat(GetU32(record + 4));
+        input.buttons = record[8];
+        frames.push_back(input);
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Map.h"
+#include "Simulation.h"
+
+// Binary log of a play session: a header with the simulation seed, window size, weapon, path mode and the
+// level (its file, size and MapChecksum), then one 9 byte record per frame (dt, mouse motion, buttons).
+// Replaying the records through Simulation::Step from the same seed, weapon and path mode on the same
+// level reproduces the session exactly.
+
+// appends frames to a log file while the game runs
+class InputRecorder
+{
+public:
+    ~InputRecorder() { Close(); }
+
+    // returns false if the file can't be created
+    // map is the level played, loaded from mapPath or the built-in one if that is null
+    bool Open(const char *path, uint32_t seed, int width, int height, const WeaponConfig &weapon,
+              PathMode pathMode, const char *mapPath, const Map &map);
+    void Write(const FrameInput &input);
+    void Close();
+
+    bool IsOpen() const { return file != nullptr; }
+
+private:
+    FILE *file = nullptr;
+};
+
+// a whole recorded session
+struct InputLog
+{
+    uint32_t seed = 0;
+    int width = 0;
+    int height = 0;
+    WeaponConfig weapon;
+    PathMode pathMode = PathMode::AStar;
+    std::string mapPath; // empty for the built-in map
+    int mapWidth = 0;
+    int mapHeight = 0;
+    uint64_t mapChecksum = 0;
+    std::vector<FrameInput> frames;
+
+    // returns false if the file can't be read or isn't an input log
+    bool Load(const char *path);
+};
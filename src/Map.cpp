@@ -0,0 +1,78 @@
+#include "Map.h"
+#include <cstdio>
+#include <cstring>
+
+// the built-in map is checked when it is compiled, so the game never has to
+static_assert(sizeof(worldMap) - 1 == mapWidth * mapHeight, "worldMap is not mapWidth * mapHeight tiles");
+static_assert(FindBadTile(worldMap, mapWidth, mapHeight, builtinTiles.info) < 0,
+              "worldMap has an unknown tile type or a floor on its edge");
+
+
+const Map &GetBuiltinMap()
+{
+    static const Map map{mapWidth, mapHeight, worldMap, floorTexture, ceilingTexture, &builtinTiles};
+    return map;
+}
+
+static const Map *currentMap = nullptr;
+
+const Map &GetWorldMap()
+{
+    return currentMap ? *currentMap : GetBuiltinMap();
+}
+
+void SetWorldMap(const Map &map)
+{
+    currentMap = &map;
+}
+
+char getTile(int x, int y)
+{
+    return GetWorldMap().Tile(x, y);
+}
+
+uint64_t MapChecksum(const Map &map)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint8_t byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    // tile ids the map doesn't use don't count
+    for (size_t i = 0; i < (size_t)map.width * map.height; ++i)
+    {
+        mix((uint8_t)map.tiles[i]);
+        mix(map.Info(map.tiles[i]).flags);
+    }
+    const float start[2] = {map.startX, map.startY};
+    for (int i = 0; i < 2; ++i)
+    {
+        uint32_t bits;
+        memcpy(&bits, &start[i], 4);
+        for (int b = 0; b < 4; ++b)
+            mix((uint8_t)(bits >> (8 * b)));
+    }
+    return hash;
+}
+
+bool ValidateMap(const Map &map)
+{
+    if (map.width < 3 || map.height < 3)
+    {
+        fprintf(stderr, "Map size %dx%d is too small\n", map.width, map.height);
+        return false;
+    }
+
+    const int bad = FindBadTile(map.tiles, map.width, map.height, map.tileTable->info);
+    if (bad < 0)
+        return true;
+
+    const int x = bad % map.width;
+    const int y = bad / map.width;
+    const char tile = map.Tile(x, y);
+    if (map.Info(tile).flags & TileWalkable)
+        fprintf(stderr, "map edge at [%3d,%3d] is a floor (should be wall)\n", x, y);
+    else
+        fprintf(stderr, "map tile at [%3d,%3d] has an unknown tile type(%c)\n", x, y, tile);
+    return false;
+}
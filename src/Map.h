@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// list of wall texture types, in order as they appear in the full texture
+enum class WallTexture
+{
+    Smiley,
+    Red,
+    Bush,
+    Sky,
+    Pink,
+    Wallpaper,
+    Dirt,
+    Exit,
+};
+
+// valid wall types and their texture for the world map
+struct WallType
+{
+    char tile;
+    WallTexture texture;
+};
+constexpr WallType wallTypes[] = {
+    {'#', WallTexture::Pink},
+    {'=', WallTexture::Dirt},
+    {'M', WallTexture::Wallpaper},
+    {'N', WallTexture::Bush},
+    {'~', WallTexture::Sky},
+    {'!', WallTexture::Red},
+    {'@', WallTexture::Smiley},
+    {'^', WallTexture::Exit},
+};
+
+// textures of the floor and ceiling of every open tile
+const WallTexture floorTexture = WallTexture::Dirt;
+const WallTexture ceilingTexture = WallTexture::Bush;
+
+// size of the top-down world map in tiles
+const int mapWidth = 24;
+const int mapHeight = 24;
+
+// top-down view of world map
+constexpr char worldMap[] =
+    "~~~~~~~~~~~~~~~~!!!@!!!!"
+    "~..............!!......!"
+    "~..............!@......!"
+    "~..............!!......@"
+    "~..............!!......!"
+    "~....N......N..........!"
+    "~..............!!!!@!!.!"
+    "~..............!!!!!!!.!"
+    "~..............#!!!!!!.@"
+    "~..............!!......!"
+    "~...N....N.....!!..N..!!"
+    "~.....................!!"
+    "~..............!!..N..!!"
+    "~..............!!.....!#"
+    "~...........N..!!#!!!.!!"
+    "~..............!!!!!!.!!"
+    "!.!!!!!!.!!!!!!........!"
+    "!.!....=.=..........=..!"
+    "@.!.=..=.=..!!..=...=..!"
+    "!...........!#..==..=..#"
+    "!.!!!!!!.=..!!.........!"
+    "!.!!!!!!.=..!!....=....!"
+    "!......................^"
+    "!!!#!!!!!!#!!!@!!!!#!!!!";
+
+// TileInfo::texture of tiles that aren't walls
+const uint8_t noWall = 0xFF;
+
+enum TileFlags : uint8_t
+{
+    TileWalkable = 1, // players and enemies can stand on it
+    TileOpaque = 2,   // stops rays, drawn as a wall
+};
+
+// attributes of a tile id, looked up in a 256 entry table instead of comparing tiles against '.'
+struct TileInfo
+{
+    uint8_t flags = 0;           // TileFlags
+    uint8_t texture = noWall;    // WallTexture of walls
+    uint8_t shade = 256 * 3 / 4; // brightness of the y-side faces, in 1/256ths
+};
+
+struct TileTable
+{
+    TileInfo info[256];
+    uint32_t opaqueBits[8] = {}; // TileOpaque of every id as a bit, for the AVX2 ray packets
+
+    // call after changing info
+    constexpr void UpdateBits()
+    {
+        for (uint32_t &bits : opaqueBits)
+            bits = 0;
+        for (int id = 0; id < 256; ++id)
+            if (info[id].flags & TileOpaque)
+                opaqueBits[id >> 5] |= 1u << (id & 31);
+    }
+};
+
+// '.' is floor, the wallTypes are walls, everything else is unknown (neither walkable nor opaque)
+constexpr TileTable MakeTileTable()
+{
+    TileTable table{};
+    table.info[(uint8_t)'.'].flags = TileWalkable;
+    for (const WallType &type : wallTypes)
+    {
+        TileInfo &info = table.info[(uint8_t)type.tile];
+        info.flags = TileOpaque;
+        info.texture = (uint8_t)type.texture;
+    }
+    table.UpdateBits();
+    return table;
+}
+
+inline constexpr TileTable builtinTiles = MakeTileTable();
+
+// index of the first tile of a width x height grid that is of an unknown type or a floor on the edge, -1 if
+// there is none. Edges have to be walls so rays stop there without checking the map bounds
+constexpr int FindBadTile(const char *tiles, int width, int height, const TileInfo *tileInfo)
+{
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const TileInfo &info = tileInfo[(uint8_t)tiles[y * width + x]];
+            const bool edge = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+            if (!(info.flags & (TileWalkable | TileOpaque)) || (edge && !(info.flags & TileOpaque)))
+                return y * width + x;
+        }
+    return -1;
+}
+
+// read-only view of a tile grid, used by the renderer so it doesn't depend on the globals above
+struct Map
+{
+    int width = 0;
+    int height = 0;
+    const char *tiles = nullptr;
+    WallTexture floor = floorTexture;
+    WallTexture ceiling = ceilingTexture;
+    const TileTable *tileTable = &builtinTiles; // attributes of every tile id
+    float startX = 12.0f;                       // where the player starts
+    float startY = 12.0f;
+
+    // get a tile. Not memory safe.
+    char Tile(int x, int y) const { return tiles[(size_t)y * width + x]; }
+
+    const TileInfo &Info(char tile) const { return tileTable->info[(uint8_t)tile]; }
+
+    // can a tile be stood on. Not memory safe.
+    bool Walkable(int x, int y) const { return Info(Tile(x, y)).flags & TileWalkable; }
+};
+
+// the level being played: the built-in worldMap unless SetWorldMap switched to another one
+const Map &GetWorldMap();
+
+// play on map from now on. It has to stay valid until the next call
+void SetWorldMap(const Map &map);
+
+// the built-in worldMap as a Map view. It is checked with FindBadTile at compile time
+const Map &GetBuiltinMap();
+
+// get a tile from the current map. Not memory safe.
+char getTile(int x, int y);
+
+// FNV-1a over everything of a map that changes how the game plays on it: the tiles, whether each is
+// walkable or opaque, and the start position. Recorded sessions check it to replay on the same level
+uint64_t MapChecksum(const Map &map);
+
+// checks a map for errors: unknown tile types and open edges
+// returns: true on success, false on errors found
+bool ValidateMap(const Map &map);
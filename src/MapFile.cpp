@@ -0,0 +1,288 @@
+#include "MapFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the header is read in place from the mapping, little-endian like every platform the game runs on
+static_assert(sizeof(MapFileHeader) == 288, "MapFileHeader layout changed, bump mapFileVersion");
+
+static const char mapFileMagic[4] = {'R', 'C', 'M', 'P'};
+static const uint32_t mapFileVersion = 1;
+
+bool MapFile::Open(const char *path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        fprintf(stderr, "Could not map %s\n", path);
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const uint8_t *)view;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    struct stat info;
+    void *view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (view == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not map %s\n", path);
+        return false;
+    }
+    data = (const uint8_t *)view;
+    size = (size_t)info.st_size;
+#endif
+
+    // only the header is checked; the tiles were validated when the level was baked
+    MapFileHeader header;
+    if (size < sizeof(header))
+    {
+        fprintf(stderr, "%s is not a level file\n", path);
+        Close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, mapFileMagic, 4) != 0 || header.version != mapFileVersion)
+    {
+        fprintf(stderr, "%s is not a level file\n", path);
+        Close();
+        return false;
+    }
+    if (header.width < 3 || header.height < 3 || header.width > (uint32_t)maxMapSide ||
+        header.height > (uint32_t)maxMapSide || header.tilesOffset < sizeof(header) ||
+        header.tilesOffset + (size_t)header.width * header.height > size)
+    {
+        fprintf(stderr, "%s is damaged (%ux%u tiles, %zu bytes)\n", path, header.width, header.height, size);
+        Close();
+        return false;
+    }
+
+    // keep a bad table entry from indexing outside the atlas: anything but floor is some wall
+    for (int id = 0; id < 256; ++id)
+    {
+        TileInfo &info = tileTable.info[id];
+        info = TileInfo();
+        if (id == '.')
+        {
+            info.flags = TileWalkable;
+            continue;
+        }
+        info.flags = TileOpaque;
+        info.texture = header.tileTextures[id] <= (uint8_t)WallTexture::Exit ? header.tileTextures[id] : 0;
+    }
+
+    map.width = (int)header.width;
+    map.height = (int)header.height;
+    map.tiles = (const char *)data + header.tilesOffset;
+    map.floor = (WallTexture)(header.floorTexture <= (uint8_t)WallTexture::Exit ? header.floorTexture : 0);
+    map.ceiling = (WallTexture)(header.ceilingTexture <= (uint8_t)WallTexture::Exit ? header.ceilingTexture : 0);
+    tileTable.UpdateBits();
+    map.tileTable = &tileTable;
+    map.startX = header.startX;
+    map.startY = header.startY;
+
+    // rays stop at the walls around the level instead of checking the bounds, so those have to be intact
+    // even in a damaged file. This is the only part of the grid read here
+    bool closed = true;
+    for (int x = 0; x < map.width; ++x)
+        closed &= !map.Walkable(x, 0) && !map.Walkable(x, map.height - 1);
+    for (int y = 0; y < map.height; ++y)
+        closed &= !map.Walkable(0, y) && !map.Walkable(map.width - 1, y);
+    if (!closed)
+    {
+        fprintf(stderr, "%s is damaged (floor on its edge)\n", path);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MapFile::Close()
+{
+    if (!data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    mappingHandle = fileHandle = nullptr;
+#else
+    munmap((void *)data, size);
+#endif
+    data = nullptr;
+    size = 0;
+    map = Map();
+}
+
+bool SaveMapFile(const char *path, const Map &map)
+{
+    if (!ValidateMap(map))
+        return false;
+    if (map.width > maxMapSide || map.height > maxMapSide)
+    {
+        fprintf(stderr, "Map size %dx%d is larger than %dx%d\n", map.width, map.height, maxMapSide, maxMapSide);
+        return false;
+    }
+    const int startX = (int)map.startX;
+    const int startY = (int)map.startY;
+    if (startX < 0 || startY < 0 || startX >= map.width || startY >= map.height || !map.Walkable(startX, startY))
+    {
+        fprintf(stderr, "Start position (%.1f, %.1f) is not on the floor\n", map.startX, map.startY);
+        return false;
+    }
+
+    MapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, mapFileMagic, 4);
+    header.version = mapFileVersion;
+    header.width = (uint32_t)map.width;
+    header.height = (uint32_t)map.height;
+    header.tilesOffset = (sizeof(header) + 63) & ~63u;
+    header.floorTexture = (uint8_t)map.floor;
+    header.ceilingTexture = (uint8_t)map.ceiling;
+    header.startX = map.startX;
+    header.startY = map.startY;
+    for (int id = 0; id < 256; ++id)
+    {
+        const TileInfo &info = map.tileTable->info[id];
+        header.tileTextures[id] = info.flags & TileOpaque ? info.texture : noWall;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write %s\n", path);
+        return false;
+    }
+    const uint8_t padding[64] = {};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(padding, 1, header.tilesOffset - sizeof(header), file);
+    fwrite(map.tiles, 1, (size_t)map.width * map.height, file);
+
+    const bool ok = !ferror(file);
+    fclose(file);
+    if (!ok)
+        fprintf(stderr, "Could not write %s\n", path);
+    return ok;
+}
+
+bool ImportTextMap(const char *path, std::vector<char> &tiles, Map &map)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+
+    tiles.clear();
+    int width = 0;
+    int height = 0;
+    char buffer[maxMapSide + 64];
+    std::string line;
+    bool ok = true;
+    while (ok && fgets(buffer, sizeof(buffer), file))
+    {
+        line = buffer;
+        // the rest of an overlong line
+        while (!line.empty() && line.back() != '\n' && fgets(buffer, sizeof(buffer), file))
+            line += buffer;
+
+        // trim whitespace, then take what's between the quotes of a quoted row
+        const size_t first = line.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos)
+            continue;
+        line = line.substr(first, line.find_last_not_of(" \t\r\n") - first + 1);
+        if (line[0] == '"')
+        {
+            const size_t close = line.find('"', 1);
+            if (close == std::string::npos)
+            {
+                fprintf(stderr, "%s: row %d has no closing quote\n", path, height + 1);
+                ok = false;
+                break;
+            }
+            line = line.substr(1, close - 1);
+        }
+
+        if (height == 0)
+            width = (int)line.size();
+        if ((int)line.size() != width)
+        {
+            fprintf(stderr, "%s: row %d is %d tiles wide, expected %d\n", path, height + 1, (int)line.size(), width);
+            ok = false;
+        }
+        else if (width > maxMapSide || height >= maxMapSide)
+        {
+            fprintf(stderr, "%s is larger than %dx%d\n", path, maxMapSide, maxMapSide);
+            ok = false;
+        }
+        tiles.insert(tiles.end(), line.begin(), line.end());
+        ++height;
+    }
+    fclose(file);
+    if (!ok)
+        return false;
+
+    map = GetBuiltinMap();
+    map.width = width;
+    map.height = height;
+    map.tiles = tiles.data();
+
+    // start where the built-in map does if that's open floor, on the first floor tile otherwise
+    const int startX = (int)map.startX, startY = (int)map.startY;
+    if (startX >= width || startY >= height || !map.Walkable(startX, startY))
+    {
+        const size_t first = std::find_if(tiles.begin(), tiles.end(), [&map](char tile) {
+                                 return map.Info(tile).flags & TileWalkable;
+                             }) - tiles.begin();
+        if (first < tiles.size())
+        {
+            map.startX = first % width + 0.5f;
+            map.startY = first / width + 0.5f;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+// Binary level file (.rcmap), mapped straight into memory so even 8192x8192 levels open without a parse
+// step:
+//
+//     MapFileHeader, then at tilesOffset the width * height tile grid, one byte (tile id) per tile
+//
+// Tile ids are the ASCII glyphs of the text format ('.' is floor) and the header's tile table gives the
+// WallTexture of every id. Levels are validated once when they are baked (SaveMapFile); loading only checks
+// the header and that the edges are walls.
+struct MapFileHeader
+{
+    char magic[4];             // "RCMP"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesOffset;      // from the start of the file, a multiple of 64
+    uint8_t floorTexture;      // WallTexture of the floor and ceiling
+    uint8_t ceilingTexture;
+    uint8_t reserved[2];
+    float startX;              // where the player starts
+    float startY;
+    uint8_t tileTextures[256]; // WallTexture of every tile id, noWall for floor
+};
+
+// the largest level a file may hold per side
+const int maxMapSide = 8192;
+
+// a level file mapped into memory for as long as the object lives
+class MapFile
+{
+public:
+    MapFile() = default;
+    ~MapFile() { Close(); }
+
+    MapFile(const MapFile &) = delete;
+    MapFile &operator=(const MapFile &) = delete;
+
+    // map the file and check its header. Returns false with a message on stderr if it isn't a level
+    bool Open(const char *path);
+    void Close();
+
+    const Map &GetMap() const { return map; }
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+    Map map;
+    TileTable tileTable;
+};
+
+// validate map (ValidateMap) and write it as a level file. Returns false with a message on stderr if it
+// isn't valid or the file can't be written
+bool SaveMapFile(const char *path, const Map &map);
+
+// read a text level: one row of tile glyphs per line, optionally in double quotes like worldMap in
+// Map.h. The tiles are stored in tiles and map points at them, with the built-in tile types. The player
+// starts where it does on the built-in map, or on the first floor tile if that's a wall
+bool ImportTextMap(const char *path, std::vector<char> &tiles, Map &map);
@@ -0,0 +1,184 @@
+#include "Palette.h"
+#include <algorithm>
+
+// one histogram bin of the 15 bit colour cube, with the full precision colours that fell into it
+struct ColorBin
+{
+    int channel[3] = {}; // 5 bit red, green, blue
+    uint32_t count = 0;
+    uint64_t sum[3] = {}; // 8 bit red, green, blue summed over count texels
+};
+
+// a box of bins for median cut
+struct ColorBox
+{
+    int begin = 0;
+    int end = 0;
+    int longest = 0; // channel with the largest range
+    int range = 0;
+};
+
+static ColorBox MakeBox(const std::vector<ColorBin> &bins, int begin, int end)
+{
+    ColorBox box;
+    box.begin = begin;
+    box.end = end;
+    for (int c = 0; c < 3; ++c)
+    {
+        int low = 31;
+        int high = 0;
+        for (int i = begin; i < end; ++i)
+        {
+            low = std::min(low, bins[i].channel[c]);
+            high = std::max(high, bins[i].channel[c]);
+        }
+        if (high - low > box.range)
+        {
+            box.range = high - low;
+            box.longest = c;
+        }
+    }
+    return box;
+}
+
+static inline int Channel(uint32_t color, int c) { return (color >> (16 - 8 * c)) & 0xFF; }
+
+static inline uint32_t Pack(int r, int g, int b)
+{
+    return 0xFF000000 | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
+void Palette::Build(const TextureAtlas &atlas, uint32_t fog)
+{
+    fogColor = fog;
+
+    // histogram of the opaque level 0 texels
+    std::vector<ColorBin> histogram(32768);
+    const size_t level0 = (size_t)atlas.tileCount * atlas.tileSize * atlas.tileSize;
+    for (size_t i = 0; i < level0; ++i)
+    {
+        const uint32_t texel = atlas.texels[i];
+        if (IsColorKey(texel))
+            continue;
+        ColorBin &bin = histogram[((texel >> 9) & 0x7C00) | ((texel >> 6) & 0x03E0) | ((texel >> 3) & 0x001F)];
+        ++bin.count;
+        for (int c = 0; c < 3; ++c)
+            bin.sum[c] += Channel(texel, c);
+    }
+
+    std::vector<ColorBin> bins;
+    for (int i = 0; i < 32768; ++i)
+    {
+        if (!histogram[i].count)
+            continue;
+        ColorBin bin = histogram[i];
+        bin.channel[0] = (i >> 10) & 31;
+        bin.channel[1] = (i >> 5) & 31;
+        bin.channel[2] = i & 31;
+        bins.push_back(bin);
+    }
+
+    // median cut: keep splitting the box with the longest side at the texel-weighted median of that side
+    std::vector<ColorBox> boxes;
+    if (!bins.empty())
+        boxes.push_back(MakeBox(bins, 0, (int)bins.size()));
+    while ((int)boxes.size() < paletteSize - 1)
+    {
+        int widest = -1;
+        for (int i = 0; i < (int)boxes.size(); ++i)
+            if (boxes[i].end - boxes[i].begin > 1 && (widest < 0 || boxes[i].range > boxes[widest].range))
+                widest = i;
+        if (widest < 0)
+            break;
+
+        const ColorBox box = boxes[widest];
+        const int c = box.longest;
+        std::sort(bins.begin() + box.begin, bins.begin() + box.end,
+                  [c](const ColorBin &a, const ColorBin &b) { return a.channel[c] < b.channel[c]; });
+
+        uint64_t total = 0;
+        for (int i = box.begin; i < box.end; ++i)
+            total += bins[i].count;
+        uint64_t below = 0;
+        int split = box.begin + 1;
+        for (int i = box.begin; i < box.end - 1; ++i)
+        {
+            below += bins[i].count;
+            split = i + 1;
+            if (below * 2 >= total)
+                break;
+        }
+
+        boxes[widest] = MakeBox(bins, box.begin, split);
+        boxes.push_back(MakeBox(bins, split, box.end));
+    }
+
+    // entry 0 is transparent, the boxes' average colours follow
+    colors[0] = 0x00000000;
+    int used = 1;
+    for (const ColorBox &box : boxes)
+    {
+        uint64_t count = 0;
+        uint64_t sum[3] = {};
+        for (int i = box.begin; i < box.end; ++i)
+        {
+            count += bins[i].count;
+            for (int c = 0; c < 3; ++c)
+                sum[c] += bins[i].sum[c];
+        }
+        colors[used++] = Pack((int)((sum[0] + count / 2) / count), (int)((sum[1] + count / 2) / count),
+                              (int)((sum[2] + count / 2) / count));
+    }
+    for (; used < paletteSize; ++used)
+        colors[used] = Pack(0, 0, 0);
+
+    // closest opaque entry for the centre of every 15 bit colour
+    nearest.resize(32768);
+    for (int i = 0; i < 32768; ++i)
+    {
+        const int r = ((i >> 10) & 31) * 8 + 4;
+        const int g = ((i >> 5) & 31) * 8 + 4;
+        const int b = (i & 31) * 8 + 4;
+        int best = 1;
+        int bestDistance = 1 << 30;
+        for (int entry = 1; entry < paletteSize; ++entry)
+        {
+            const int dr = Channel(colors[entry], 0) - r;
+            const int dg = Channel(colors[entry], 1) - g;
+            const int db = Channel(colors[entry], 2) - b;
+            const int distance = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                best = entry;
+            }
+        }
+        nearest[i] = (uint8_t)best;
+    }
+
+    // colormaps: every entry at every light level, faded toward the fog colour
+    colormaps.resize((size_t)lightLevels * paletteSize);
+    for (int light = 0; light < lightLevels; ++light)
+    {
+        const int weight = light * 256 / (lightLevels - 1); // 0..256
+        uint8_t *map = &colormaps[(size_t)light * paletteSize];
+        map[0] = 0;
+        for (int entry = 1; entry < paletteSize; ++entry)
+        {
+            int channels[3];
+            for (int c = 0; c < 3; ++c)
+                channels[c] = (Channel(colors[entry], c) * weight + Channel(fogColor, c) * (256 - weight) + 128) >> 8;
+            map[entry] = Nearest(Pack(channels[0], channels[1], channels[2]));
+        }
+    }
+}
+
+void IndexedAtlas::Build(const TextureAtlas &atlas, const Palette &palette)
+{
+    tileSize = atlas.tileSize;
+    levelCount = atlas.levelCount;
+    levelOffsets = atlas.levelOffsets;
+    texels.resize(atlas.texels.size());
+    for (size_t i = 0; i < atlas.texels.size(); ++i)
+        texels[i] = IsColorKey(atlas.texels[i]) ? 0 : palette.Nearest(atlas.texels[i]);
+}
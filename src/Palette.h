@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Texture.h"
+
+const int paletteSize = 256;
+const int lightLevels = 32; // rows of the colormaps, 0 is fully fogged and lightLevels - 1 full brightness
+
+// 256 colour palette quantized from the atlas, with one colormap per light level that maps a colour to
+// the palette entry closest to it at that level, faded toward the fog colour. Shading and fog then cost a
+// byte lookup per pixel instead of three float multiplies.
+struct Palette
+{
+    uint32_t colors[paletteSize] = {}; // BGRA (0xAARRGGBB). Entry 0 is transparent and maps to itself
+    uint32_t fogColor = 0xFF000000;
+    std::vector<uint8_t> colormaps; // lightLevels x paletteSize
+
+    // quantize the level 0 texels of the atlas (median cut) and build the colormaps. Magenta sprite texels
+    // are left out, they become entry 0
+    void Build(const TextureAtlas &atlas, uint32_t fog = 0xFF000000);
+
+    // palette entry closest to a colour (never 0)
+    uint8_t Nearest(uint32_t color) const { return nearest[((color >> 9) & 0x7C00) | ((color >> 6) & 0x03E0) | ((color >> 3) & 0x001F)]; }
+
+    const uint8_t *Colormap(int light) const { return &colormaps[(size_t)light * paletteSize]; }
+
+private:
+    std::vector<uint8_t> nearest; // closest entry for every 15 bit colour
+};
+
+// the atlas as palette indices, with the same tiles, columns and mip levels as the source
+struct IndexedAtlas
+{
+    int tileSize = 0;
+    int levelCount = 0;
+    std::vector<size_t> levelOffsets;
+    std::vector<uint8_t> texels;
+
+    void Build(const TextureAtlas &atlas, const Palette &palette);
+
+    int LevelSize(int level) const { return tileSize >> level; }
+    const uint8_t *Column(int tile, int x, int level) const
+    {
+        const size_t size = (size_t)LevelSize(level);
+        return &texels[levelOffsets[level] + ((size_t)tile * size + x) * size];
+    }
+};
+
+// everything the indexed pipeline needs next to the 32 bit atlas
+struct IndexedTextures
+{
+    Palette palette;
+    IndexedAtlas atlas;
+
+    void Build(const TextureAtlas &source, uint32_t fog = 0xFF000000)
+    {
+        palette.Build(source, fog);
+        atlas.Build(source, palette);
+    }
+};
+
+// magenta is the transparent color key of the sprites
+inline bool IsColorKey(uint32_t texel) { return (texel & 0xFF) > 0xEE && ((texel >> 16) & 0xFF) > 0xEE; }
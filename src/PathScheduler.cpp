@@ -0,0 +1,78 @@
+#include "PathScheduler.h"
+#include <algorithm>
+#include <cstdlib>
+#include "Profiler.h"
+
+// a tile of a flood inside a cluster costs about a sixteenth of an A* node (no heap, no heuristic)
+static const int floodTilesPerNode = 16;
+
+void PathScheduler::Serve(EnemyStore &enemies, const IPoint &playerTile, ClusterGraph *clusters)
+{
+    searches = 0;
+    expanded = 0;
+
+    requests.clear();
+    for (int i = 0; i < (int)enemies.Size(); ++i)
+    {
+        if (!enemies.path[i].requested)
+            continue;
+        const IPoint start = WorldToTile(enemies.pos[i]);
+        const int distance = std::abs(start.x - playerTile.x) + std::abs(start.y - playerTile.y);
+        requests.push_back({i, start, enemies.path[i].requestGoal, distance});
+    }
+
+    // nearest first. Identical searches start on the same tile, so they have the same distance and end up
+    // next to each other
+    std::sort(requests.begin(), requests.end(), [](const Request &a, const Request &b) {
+        if (a.distance != b.distance)
+            return a.distance < b.distance;
+        if (a.start.y != b.start.y)
+            return a.start.y < b.start.y;
+        if (a.start.x != b.start.x)
+            return a.start.x < b.start.x;
+        if (a.goal.y != b.goal.y)
+            return a.goal.y < b.goal.y;
+        if (a.goal.x != b.goal.x)
+            return a.goal.x < b.goal.x;
+        return a.enemy < b.enemy;
+    });
+
+    size_t next = 0;
+    while (next < requests.size() && (searches == 0 || budget <= 0 || expanded < budget))
+    {
+        const Request &request = requests[next];
+        EnemyPath &first = enemies.path[request.enemy];
+        if (clusters)
+        {
+            // route over the clusters, then the tile path through the first one
+            PROFILE_ZONE("ClusterGraph::FindRoute");
+            first.tiles.clear();
+            if (clusters->FindRoute(request.start, request.goal, first.route))
+                clusters->NextSegment(first.route, first.tiles);
+            expanded += clusters->Expanded() + clusters->Flooded() / floodTilesPerNode;
+        }
+        else
+        {
+            // into the path's existing storage
+            PROFILE_ZONE("PathSearch::AStar");
+            search.AStar(GetWorldMap(), request.start, request.goal, first.tiles);
+            expanded += search.Expanded();
+        }
+        ++searches;
+
+        size_t end = next + 1;
+        while (end < requests.size() && requests[end].start == request.start && requests[end].goal == request.goal)
+        {
+            EnemyPath &other = enemies.path[requests[end].enemy];
+            other.tiles = first.tiles;
+            other.route = first.route;
+            ++end;
+        }
+        for (; next < end; ++next)
+        {
+            enemies.pathIndex[requests[next].enemy] = 0;
+            enemies.path[requests[next].enemy].requested = false;
+        }
+    }
+    pending = (int)(requests.size() - next);
+}
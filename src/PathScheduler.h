@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "ClusterGraph.h"
+#include "EnemyStore.h"
+#include "Pathfinding.h"
+
+// The walkers' path requests, served a frame's budget at a time. When the player steps onto another tile
+// every walker asks for a new path in the same frame; the scheduler spreads that burst over the following
+// frames, and walkers keep following their old path until theirs is served. The walkers nearest to the
+// player are served first, and walkers on the same tile heading for the same goal share one search.
+//
+// The budget counts search nodes expanded rather than microseconds, so a recorded session replays the same
+// on any machine. An A* node costs around 0.1-0.2 us. Cluster graph routes count their graph nodes plus
+// the tiles their floods inside the start and goal clusters reach, weighted by what those cost.
+class PathScheduler
+{
+public:
+    static const int defaultBudget = 8192; // enough for 20 walkers crossing the built-in map in one frame
+
+    // nodes expanded per frame before the remaining requests wait for the next one, 0 for no limit
+    void SetBudget(int nodesPerFrame) { budget = nodesPerFrame; }
+    int GetBudget() const { return budget; }
+
+    // serve the pending requests of enemies, nearest to playerTile first, until the budget is spent. At
+    // least one search runs per frame, so a frame goes over the budget by one search at most. Requests are
+    // routed over clusters if given, searched with A* otherwise
+    void Serve(EnemyStore &enemies, const IPoint &playerTile, ClusterGraph *clusters);
+
+    int Pending() const { return pending; }   // requests left for the next frame by the last Serve
+    int Searches() const { return searches; } // searches run by the last Serve
+    int Expanded() const { return expanded; } // nodes expanded by the last Serve
+
+private:
+    struct Request
+    {
+        int enemy;
+        IPoint start; // the enemy's tile when served
+        IPoint goal;
+        int distance; // from start to the player's tile, the priority
+    };
+
+    int budget = defaultBudget;
+    std::vector<Request> requests;
+    PathSearch search;
+    int pending = 0;
+    int searches = 0;
+    int expanded = 0;
+};
@@ -16,14 +16,34 @@ struct PQItem {
 };
 
 
-static inline int ToIndex(int x, int y) { return y * mapWidth + x; }
+IPoint FindNearestWalkableAround(const IPoint& center, int maxRadius)
+{
+    if (IsWalkable(center.x, center.y)) return center;
+    for (int r = 1; r <= maxRadius; ++r) {
+        // scan a diamond ring (Manhattan distance r)
+        for (int dx = -r; dx <= r; ++dx) {
+            int dy1 = r - std::abs(dx);
+            int dy2 = -dy1;
+            int tx1 = center.x + dx;
+            int ty1 = center.y + dy1;
+            int tx2 = center.x + dx;
+            int ty2 = center.y + dy2;
+            if (IsWalkable(tx1, ty1)) return {tx1, ty1};
+            if (IsWalkable(tx2, ty2)) return {tx2, ty2};
+        }
+    }
+    return center; // fallback to center; A* will return empty if not walkable
+}
+
+static inline int ToIndex(int x, int y) { return y * GetWorldMap().width + x; }
 
 
 std::vector<IPoint> AStarTilePath(const IPoint& start, const IPoint& goal) {
     if (!InBounds(start.x, start.y) || !InBounds(goal.x, goal.y)) return {};
     if (!IsWalkable(start.x, start.y) || !IsWalkable(goal.x, goal.y)) return {};
 
-    const int N = mapWidth * mapHeight;
+    const int mapWidth = GetWorldMap().width;
+    const int N = mapWidth * GetWorldMap().height;
     std::vector<int> gScore(N, (std::numeric_limits<int>::max)());
     std::vector<int> cameFrom(N, -1);
     std::vector<char> closed(N, 0);
@@ -74,4 +94,177 @@ std::vector<IPoint> AStarTilePath(const IPoint& start, const IPoint& goal) {
         }
     }
     return {};
-}
\ No newline at end of file
+}
+
+void PathSearch::Begin(const Map& searchMap) {
+    map = &searchMap;
+    width = searchMap.width;
+    const size_t tiles = (size_t)searchMap.width * searchMap.height;
+    if (nodes.size() != tiles) {
+        nodes.assign(tiles, Node());
+        generation = 0;
+    }
+    // stamps hold the generation in 31 bits; clear them once every 2^31 searches
+    if (++generation >= 0x7FFFFFFFu) {
+        std::fill(nodes.begin(), nodes.end(), Node());
+        generation = 1;
+    }
+    open.clear();
+    expanded = 0;
+}
+
+void PathSearch::Push(int idx, int g, int parent, const IPoint& at, const IPoint& goal) {
+    nodes[idx] = { generation << 1, g, parent };
+    open.push_back({ idx, g + Heuristic(at, goal) });
+    std::push_heap(open.begin(), open.end());
+}
+
+void PathSearch::WritePath(int goalIdx, std::vector<IPoint>& path) const {
+    // g of the goal is the number of steps, whether the parents are neighbours or jump points
+    path.resize(nodes[goalIdx].g + 1);
+    size_t out = path.size();
+    IPoint at = { goalIdx % width, goalIdx / width };
+    path[--out] = at;
+    for (int idx = goalIdx; nodes[idx].parent != -1; idx = nodes[idx].parent) {
+        const int parent = nodes[idx].parent;
+        const IPoint to = { parent % width, parent / width };
+        while (at != to) {
+            at.x += (to.x > at.x) - (to.x < at.x);
+            at.y += (to.y > at.y) - (to.y < at.y);
+            path[--out] = at;
+        }
+    }
+}
+
+bool PathSearch::AStar(const Map& searchMap, const IPoint& start, const IPoint& goal, std::vector<IPoint>& path) {
+    Begin(searchMap);
+    path.clear();
+    auto inBounds = [&](int x, int y) { return x >= 0 && y >= 0 && x < searchMap.width && y < searchMap.height; };
+    if (!inBounds(start.x, start.y) || !inBounds(goal.x, goal.y)) return false;
+    if (!Open(start.x, start.y) || !Open(goal.x, goal.y)) return false;
+
+    const int goalIdx = goal.y * width + goal.x;
+    Push(start.y * width + start.x, 0, -1, start, goal);
+
+    // the open list is a heap with the same ordering as AStarTilePath's priority_queue, so ties are
+    // broken the same way and the paths match
+    while (!open.empty()) {
+        const OpenItem cur = open.front();
+        std::pop_heap(open.begin(), open.end());
+        open.pop_back();
+        if (Closed(cur.idx)) continue;
+        nodes[cur.idx].stamp |= 1;
+        ++expanded;
+
+        if (cur.idx == goalIdx) {
+            WritePath(goalIdx, path);
+            return true;
+        }
+
+        const int cx = cur.idx % width;
+        const int cy = cur.idx / width;
+        static const int DX[4] = { 1, -1, 0, 0 };
+        static const int DY[4] = { 0, 0, 1, -1 };
+        for (int i = 0; i < 4; ++i) {
+            const int nx = cx + DX[i];
+            const int ny = cy + DY[i];
+            if (!inBounds(nx, ny) || !Open(nx, ny)) continue;
+            const int nIdx = ny * width + nx;
+            if (Closed(nIdx)) continue;
+            const int tentativeG = nodes[cur.idx].g + 1;
+            if (!Reached(nIdx) || tentativeG < nodes[nIdx].g)
+                Push(nIdx, tentativeG, cur.idx, { nx, ny }, goal);
+        }
+    }
+    return false;
+}
+
+// Jump Point Search on a 4-connected grid. Of all shortest paths only the canonical ones are searched:
+// horizontal first, turning vertical anywhere, but turning back to horizontal only where a wall blocked
+// going sideways one tile earlier (a forced neighbour). Horizontal moves are therefore followed by
+// vertical scans from every tile they pass, and stop at a tile where one of those scans finds something.
+// The map's walls around the edge stop every scan, so no bounds checks are needed.
+int PathSearch::JumpVertical(int x, int y, int dy, const IPoint& goal) const {
+    while (true) {
+        y += dy;
+        if (!Open(x, y)) return -1;
+        if (x == goal.x && y == goal.y) return y * width + x;
+        if ((Open(x + 1, y) && !Open(x + 1, y - dy)) || (Open(x - 1, y) && !Open(x - 1, y - dy)))
+            return y * width + x;
+    }
+}
+
+int PathSearch::JumpHorizontal(int x, int y, int dx, const IPoint& goal) const {
+    while (true) {
+        x += dx;
+        if (!Open(x, y)) return -1;
+        if (x == goal.x && y == goal.y) return y * width + x;
+        if (JumpVertical(x, y, 1, goal) != -1 || JumpVertical(x, y, -1, goal) != -1)
+            return y * width + x;
+    }
+}
+
+bool PathSearch::JumpPoint(const Map& searchMap, const IPoint& start, const IPoint& goal, std::vector<IPoint>& path) {
+    Begin(searchMap);
+    path.clear();
+    auto inBounds = [&](int x, int y) { return x >= 0 && y >= 0 && x < searchMap.width && y < searchMap.height; };
+    if (!inBounds(start.x, start.y) || !inBounds(goal.x, goal.y)) return false;
+    if (!Open(start.x, start.y) || !Open(goal.x, goal.y)) return false;
+
+    const int goalIdx = goal.y * width + goal.x;
+    Push(start.y * width + start.x, 0, -1, start, goal);
+
+    while (!open.empty()) {
+        const OpenItem cur = open.front();
+        std::pop_heap(open.begin(), open.end());
+        open.pop_back();
+        if (Closed(cur.idx)) continue;
+        nodes[cur.idx].stamp |= 1;
+        ++expanded;
+
+        if (cur.idx == goalIdx) {
+            WritePath(goalIdx, path);
+            return true;
+        }
+
+        const int cx = cur.idx % width;
+        const int cy = cur.idx / width;
+
+        // directions worth scanning, given the direction we came from
+        int dirs[4][2];
+        int dirCount = 0;
+        const int parent = nodes[cur.idx].parent;
+        if (parent == -1) {
+            const int all[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+            for (const auto& d : all) { dirs[dirCount][0] = d[0]; dirs[dirCount][1] = d[1]; ++dirCount; }
+        } else {
+            const int px = parent % width;
+            const int py = parent / width;
+            const int dx = (cx > px) - (cx < px);
+            const int dy = (cy > py) - (cy < py);
+            if (dx != 0) {
+                dirs[dirCount][0] = dx; dirs[dirCount][1] = 0; ++dirCount;
+                dirs[dirCount][0] = 0; dirs[dirCount][1] = 1; ++dirCount;
+                dirs[dirCount][0] = 0; dirs[dirCount][1] = -1; ++dirCount;
+            } else {
+                dirs[dirCount][0] = 0; dirs[dirCount][1] = dy; ++dirCount;
+                for (int side = -1; side <= 1; side += 2) {
+                    if (Open(cx + side, cy) && !Open(cx + side, cy - dy)) {
+                        dirs[dirCount][0] = side; dirs[dirCount][1] = 0; ++dirCount;
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < dirCount; ++i) {
+            const int jump = dirs[i][0] != 0 ? JumpHorizontal(cx, cy, dirs[i][0], goal)
+                                             : JumpVertical(cx, cy, dirs[i][1], goal);
+            if (jump == -1 || Closed(jump)) continue;
+            const IPoint at = { jump % width, jump / width };
+            const int tentativeG = nodes[cur.idx].g + std::abs(at.x - cx) + std::abs(at.y - cy);
+            if (!Reached(jump) || tentativeG < nodes[jump].g)
+                Push(jump, tentativeG, cur.idx, at, goal);
+        }
+    }
+    return false;
+}
@@ -1,8 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <cmath>
-#include <d2d1.h>
-#include "raycastTest.h" // for getTile, mapWidth, mapHeight
+#include "Platform.h"
+#include "raycastTest.h" // for getTile, GetWorldMap
 
 struct IPoint {
     int x = 0;
@@ -12,12 +13,13 @@ struct IPoint {
 };
 
 inline bool InBounds(int tx, int ty) {
-    return tx >= 0 && ty >= 0 && tx < mapWidth && ty < mapHeight;
+    const Map &map = GetWorldMap();
+    return tx >= 0 && ty >= 0 && tx < map.width && ty < map.height;
 }
 
 inline bool IsWalkable(int tx, int ty) {
     if (!InBounds(tx, ty)) return false;
-    return getTile(tx, ty) == '.';
+    return GetWorldMap().Walkable(tx, ty);
 }
 
 inline IPoint WorldToTile(const D2D_POINT_2F& p) {
@@ -28,5 +30,62 @@ inline D2D_POINT_2F TileCenter(const IPoint& t) {
     return { (float)t.x + 0.5f, (float)t.y + 0.5f };
 }
 
+// Nearest walkable tile to center within maxRadius (Manhattan), center itself if there is none
+IPoint FindNearestWalkableAround(const IPoint& center, int maxRadius);
+
 // Returns tile path including start and goal. Empty if no path.
-std::vector<IPoint> AStarTilePath(const IPoint& start, const IPoint& goal);
\ No newline at end of file
+// Allocates and clears its search arrays for the whole map on every call; PathSearch doesn't.
+std::vector<IPoint> AStarTilePath(const IPoint& start, const IPoint& goal);
+
+// Reusable search state for repeated path queries. The per-tile arrays are sized to the map once and
+// invalidated by bumping a generation counter instead of being cleared, the open list keeps its capacity,
+// and paths are written into the caller's vector, so searches stop allocating after the first few.
+class PathSearch {
+public:
+    // Same search and same path as AStarTilePath, written to path (start and goal included).
+    // Returns false, with path empty, if there is none.
+    bool AStar(const Map& map, const IPoint& start, const IPoint& goal, std::vector<IPoint>& path);
+
+    // Jump Point Search: a shortest path too, but on open ground it only expands the tiles where the
+    // path may turn. Paths are horizontal first where there is a choice, so they can differ from AStar's.
+    // It only pays off on empty ground (bench, 1024x1024 corner to corner: 3 nodes against A*'s 77730,
+    // 2-3x faster). On a 4-connected grid every pillar beside a scan makes a jump point, and every
+    // horizontal step scans vertically both ways, so with 1% pillars it expands 2.9x fewer nodes but
+    // runs up to twice as slow as AStar, and with 10% 2.5x fewer for about 1.2x faster. Use HPA* there.
+    bool JumpPoint(const Map& map, const IPoint& start, const IPoint& goal, std::vector<IPoint>& path);
+
+    // nodes taken off the open list by the last search
+    int Expanded() const { return expanded; }
+
+private:
+    struct Node {
+        uint32_t stamp = 0; // generation << 1 when reached in this search, | 1 once closed
+        int g = 0;
+        int parent = -1;
+    };
+    struct OpenItem {
+        int idx;
+        int f;
+        bool operator<(const OpenItem& other) const { return f > other.f; } // min-heap
+    };
+
+    // start a search on map: resize the arrays if it changed and bump the generation
+    void Begin(const Map& map);
+    bool Reached(int idx) const { return (nodes[idx].stamp >> 1) == generation; }
+    bool Closed(int idx) const { return nodes[idx].stamp == (generation << 1 | 1); }
+    void Push(int idx, int g, int parent, const IPoint& at, const IPoint& goal);
+    // the parent chain ending at goalIdx, filled in between jump points, into path
+    void WritePath(int goalIdx, std::vector<IPoint>& path) const;
+
+    // JumpPoint helpers: the next jump point from (x, y) moving (dx, dy), -1 if there is none
+    int JumpHorizontal(int x, int y, int dx, const IPoint& goal) const;
+    int JumpVertical(int x, int y, int dy, const IPoint& goal) const;
+    bool Open(int x, int y) const { return map->Walkable(x, y); }
+
+    const Map* map = nullptr;
+    int width = 0;
+    uint32_t generation = 0;
+    std::vector<Node> nodes;
+    std::vector<OpenItem> open;
+    int expanded = 0;
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+// The game logic (collision, enemies, pathfinding) uses D2D points and SDL logging. On Windows they come
+// from the real headers; elsewhere this declares just enough of them to build the logic without a window,
+// e.g. for the bench target.
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX // std::min and std::max, not the Windows macros
+#endif
+#include <Windows.h>
+#include <SDL3/SDL.h>
+#include <d2d1.h>
+#include <d2d1helper.h>
+#else
+#include <cstdarg>
+#include <cstdio>
+
+struct D2D_POINT_2F
+{
+    float x;
+    float y;
+};
+
+namespace D2D1
+{
+inline D2D_POINT_2F Point2F(float x = 0.0f, float y = 0.0f) { return D2D_POINT_2F{x, y}; }
+}
+
+inline void SDL_Log(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+#endif
@@ -1,9 +1,6 @@
 #pragma once
 
-#include <SDL3/SDL.h>
-#include <SDL3/SDL_main.h>
-#include <Windows.h>
-#include <d2d1.h>
+#include "Platform.h"
 
 class Player
 {
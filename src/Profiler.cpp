@@ -0,0 +1,141 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// single producer ring: only the owning thread writes events and head, readers load head to see how
+// far it got
+struct ThreadEvents
+{
+    uint32_t threadId = 0;
+    std::unique_ptr<ProfileEvent[]> events{new ProfileEvent[Profiler::eventsPerThread]};
+    std::atomic<uint64_t> head{0};
+};
+
+// every thread that ever recorded a zone. Buffers are never freed, so a trace can still be written
+// after worker threads exit
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ThreadEvents>> registry;
+
+static std::atomic<uint32_t> currentFrame{0};
+
+static thread_local ThreadEvents *localEvents = nullptr;
+
+static ThreadEvents *RegisterThread()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.emplace_back(new ThreadEvents());
+    registry.back()->threadId = (uint32_t)registry.size();
+    return registry.back().get();
+}
+
+// call f(thread, event, origin) for every zone of the last frames (all of them if frames is 0), where origin
+// is the start of the earliest one
+template <class F>
+static void ForEachRecentEvent(int frames, F f)
+{
+    const uint32_t last = currentFrame.load(std::memory_order_relaxed);
+    const uint32_t first = frames > 0 && (uint32_t)frames <= last ? last - frames + 1 : 0;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t origin = UINT64_MAX;
+    for (int pass = 0; pass < 2; ++pass)
+        for (const auto &thread : registry)
+        {
+            const uint64_t head = thread->head.load(std::memory_order_acquire);
+            const uint64_t count = head < Profiler::eventsPerThread ? head : Profiler::eventsPerThread;
+            for (uint64_t i = head - count; i < head; ++i)
+            {
+                const ProfileEvent &event = thread->events[i & (Profiler::eventsPerThread - 1)];
+                if (event.frame < first)
+                    continue;
+                if (pass == 0)
+                    origin = event.startNs < origin ? event.startNs : origin;
+                else
+                    f(thread->threadId, event, origin);
+            }
+        }
+}
+
+void Profiler::BeginFrame() { currentFrame.fetch_add(1, std::memory_order_relaxed); }
+
+uint32_t Profiler::Frame() { return currentFrame.load(std::memory_order_relaxed); }
+
+uint64_t Profiler::Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Profiler::Record(const char *name, uint64_t startNs, uint64_t endNs)
+{
+    ThreadEvents *thread = localEvents;
+    if (!thread)
+        thread = localEvents = RegisterThread();
+
+    const uint64_t head = thread->head.load(std::memory_order_relaxed);
+    ProfileEvent &event = thread->events[head & (eventsPerThread - 1)];
+    event.name = name;
+    event.startNs = startNs;
+    event.endNs = endNs;
+    event.frame = currentFrame.load(std::memory_order_relaxed);
+    thread->head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const char *path, int frames)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write %s\n", path);
+        return false;
+    }
+
+    // complete ("X") events, times in microseconds
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    ForEachRecentEvent(frames, [&](uint32_t threadId, const ProfileEvent &event, uint64_t origin) {
+        fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                first ? "" : ",\n", event.name, threadId, (event.startNs - origin) / 1000.0,
+                (event.endNs - event.startNs) / 1000.0, event.frame);
+        first = false;
+    });
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    const bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+bool Profiler::WriteTrace(const char *path, int frames)
+{
+    const size_t length = strlen(path);
+    const bool csv = length >= 4 && !strcmp(path + length - 4, ".csv");
+    return csv ? WriteCsv(path, frames) : WriteChromeTrace(path, frames);
+}
+
+bool Profiler::WriteCsv(const char *path, int frames)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "frame,thread,zone,start_us,duration_us\n");
+    ForEachRecentEvent(frames, [&](uint32_t threadId, const ProfileEvent &event, uint64_t origin) {
+        fprintf(file, "%u,%u,%s,%.3f,%.3f\n", event.frame, threadId, event.name, (event.startNs - origin) / 1000.0,
+                (event.endNs - event.startNs) / 1000.0);
+    });
+
+    const bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+// Scoped-zone frame profiler. Every thread records the zones it runs into its own ring buffer without
+// locking, and the zones of the last frames can be written out as a Chrome trace (chrome://tracing,
+// ui.perfetto.dev) or as CSV.
+//
+//     PROFILE_FRAME();            // once at the start of every frame
+//     { PROFILE_ZONE("Walls"); ... }
+//
+// Building with RAYCORE_PROFILE=0 compiles the zones out entirely.
+#ifndef RAYCORE_PROFILE
+#define RAYCORE_PROFILE 1
+#endif
+
+// one finished zone
+struct ProfileEvent
+{
+    const char *name = nullptr; // string literal, never copied
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint32_t frame = 0;
+};
+
+class Profiler
+{
+public:
+    // zones kept per thread; older ones are overwritten
+    static const uint32_t eventsPerThread = 1 << 16;
+
+    // start a new frame; zones are tagged with the frame they end in
+    static void BeginFrame();
+    static uint32_t Frame();
+
+    static uint64_t Now();
+    static void Record(const char *name, uint64_t startNs, uint64_t endNs);
+
+    // write the zones of the last frames of every thread. Call while no zones are being recorded,
+    // e.g. between frames. Returns false if the file can't be written
+    static bool WriteChromeTrace(const char *path, int frames);
+    static bool WriteCsv(const char *path, int frames);
+    // CSV for a path ending in .csv, a Chrome trace otherwise
+    static bool WriteTrace(const char *path, int frames);
+};
+
+// records the time from construction to destruction as a zone
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char *name) : name(name), startNs(Profiler::Now()) {}
+    ~ProfileZone() { Profiler::Record(name, startNs, Profiler::Now()); }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+    const char *name;
+    uint64_t startNs;
+};
+
+#if RAYCORE_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::BeginFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
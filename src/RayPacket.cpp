@@ -0,0 +1,241 @@
+#include "RayPacket.h"
+
+// The packet kernels follow CastRay operation by operation (same float operations in the same order, no
+// fused multiply-adds), so every lane ends with exactly the values the scalar DDA would produce. Lanes
+// that hit a wall are masked off and keep their results while the rest of the packet keeps stepping.
+
+#if RAYCORE_X86
+
+// lane-wise mask ? a : b
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+void CastRayPacketsSSE2(const RayBasis &basis, const Map &map, int x0, int count, int width, RayHit *hits)
+{
+    const __m128 cosA = _mm_set1_ps(basis.cosA);
+    const __m128 sinA = _mm_set1_ps(basis.sinA);
+    const __m128 negSinA = _mm_set1_ps(-basis.sinA);
+    const __m128 planeHalf = _mm_set1_ps(basis.planeHalf);
+    const __m128 widthF = _mm_set1_ps((float)width);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 far = _mm_set1_ps(1e30f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    // distance from the camera to the tile edges, the same for every ray
+    const __m128 toLowX = _mm_set1_ps(basis.posX - basis.mapX);
+    const __m128 toHighX = _mm_set1_ps(basis.mapX + 1.0f - basis.posX);
+    const __m128 toLowY = _mm_set1_ps(basis.posY - basis.mapY);
+    const __m128 toHighY = _mm_set1_ps(basis.mapY + 1.0f - basis.posY);
+
+    const __m128i plusOne = _mm_set1_epi32(1);
+    const __m128i minusOne = _mm_set1_epi32(-1);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        const int x = x0 + i;
+        __m128 camX = _mm_sub_ps(_mm_div_ps(_mm_mul_ps(two, _mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3))), widthF), one);
+        __m128 plane = _mm_mul_ps(planeHalf, camX);
+        __m128 dirX = _mm_add_ps(cosA, _mm_mul_ps(plane, negSinA));
+        __m128 dirY = _mm_add_ps(sinA, _mm_mul_ps(plane, cosA));
+
+        __m128 deltaX = Select(_mm_cmpeq_ps(dirX, zero), far, _mm_and_ps(_mm_div_ps(one, dirX), absMask));
+        __m128 deltaY = Select(_mm_cmpeq_ps(dirY, zero), far, _mm_and_ps(_mm_div_ps(one, dirY), absMask));
+
+        __m128 negX = _mm_cmplt_ps(dirX, zero);
+        __m128 negY = _mm_cmplt_ps(dirY, zero);
+        __m128i stepX = Select(_mm_castps_si128(negX), minusOne, plusOne);
+        __m128i stepY = Select(_mm_castps_si128(negY), minusOne, plusOne);
+        __m128 sideDistX = _mm_mul_ps(Select(negX, toLowX, toHighX), deltaX);
+        __m128 sideDistY = _mm_mul_ps(Select(negY, toLowY, toHighY), deltaY);
+
+        __m128i mapX = _mm_set1_epi32(basis.mapX);
+        __m128i mapY = _mm_set1_epi32(basis.mapY);
+        __m128i side = _mm_setzero_si128();
+        __m128i active = _mm_set1_epi32(-1);
+        alignas(16) int tiles[4] = {0, 0, 0, 0};
+
+        while (_mm_movemask_ps(_mm_castsi128_ps(active)))
+        {
+            __m128i stepInX = _mm_castps_si128(_mm_cmplt_ps(sideDistX, sideDistY));
+            __m128i moveX = _mm_and_si128(active, stepInX);
+            __m128i moveY = _mm_andnot_si128(stepInX, active);
+
+            sideDistX = Select(_mm_castsi128_ps(moveX), _mm_add_ps(sideDistX, deltaX), sideDistX);
+            sideDistY = Select(_mm_castsi128_ps(moveY), _mm_add_ps(sideDistY, deltaY), sideDistY);
+            mapX = _mm_add_epi32(mapX, _mm_and_si128(stepX, moveX));
+            mapY = _mm_add_epi32(mapY, _mm_and_si128(stepY, moveY));
+            side = Select(active, _mm_srli_epi32(moveY, 31), side);
+
+            // SSE2 has no gather, so the tile lookups are done per lane
+            alignas(16) int laneX[4], laneY[4], laneActive[4];
+            _mm_store_si128((__m128i *)laneX, mapX);
+            _mm_store_si128((__m128i *)laneY, mapY);
+            _mm_store_si128((__m128i *)laneActive, active);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if (!laneActive[lane])
+                    continue;
+                const char tile = map.Tile(laneX[lane], laneY[lane]);
+                if (map.Info(tile).flags & TileOpaque)
+                {
+                    tiles[lane] = tile;
+                    laneActive[lane] = 0;
+                }
+            }
+            active = _mm_load_si128((const __m128i *)laneActive);
+        }
+
+        __m128 sideY = _mm_castsi128_ps(_mm_cmpeq_epi32(side, plusOne));
+        __m128 perp = Select(sideY, _mm_sub_ps(sideDistY, deltaY), _mm_sub_ps(sideDistX, deltaX));
+        perp = _mm_max_ps(perp, _mm_set1_ps(0.0001f));
+
+        alignas(16) float outPerp[4], outDirX[4], outDirY[4];
+        alignas(16) int outSide[4];
+        _mm_store_ps(outPerp, perp);
+        _mm_store_ps(outDirX, dirX);
+        _mm_store_ps(outDirY, dirY);
+        _mm_store_si128((__m128i *)outSide, side);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            RayHit &hit = hits[i + lane];
+            hit.perpWallDist = outPerp[lane];
+            hit.dirX = outDirX[lane];
+            hit.dirY = outDirY[lane];
+            hit.side = outSide[lane];
+            hit.tile = (char)tiles[lane];
+            FinishHit(basis, hit);
+        }
+    }
+}
+
+RAYCORE_TARGET_AVX2
+void CastRayPacketsAVX2(const RayBasis &basis, const Map &map, int x0, int count, int width, RayHit *hits)
+{
+    const __m256 cosA = _mm256_set1_ps(basis.cosA);
+    const __m256 sinA = _mm256_set1_ps(basis.sinA);
+    const __m256 negSinA = _mm256_set1_ps(-basis.sinA);
+    const __m256 planeHalf = _mm256_set1_ps(basis.planeHalf);
+    const __m256 widthF = _mm256_set1_ps((float)width);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 far = _mm256_set1_ps(1e30f);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 posX = _mm256_set1_ps(basis.posX);
+    const __m256 posY = _mm256_set1_ps(basis.posY);
+
+    const __m256 toLowX = _mm256_set1_ps(basis.posX - basis.mapX);
+    const __m256 toHighX = _mm256_set1_ps(basis.mapX + 1.0f - basis.posX);
+    const __m256 toLowY = _mm256_set1_ps(basis.posY - basis.mapY);
+    const __m256 toHighY = _mm256_set1_ps(basis.mapY + 1.0f - basis.posY);
+
+    const __m256i plusOne = _mm256_set1_epi32(1);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i allOnes = _mm256_set1_epi32(-1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i mapW = _mm256_set1_epi32(map.width);
+    const __m256i opaqueBits = _mm256_loadu_si256((const __m256i *)map.tileTable->opaqueBits);
+    const __m256i bitMask = _mm256_set1_epi32(31);
+    const __m256i oneBit = _mm256_set1_epi32(1);
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i two32 = _mm256_set1_epi32(2);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i zeroI = _mm256_setzero_si256();
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x0 + i), lanes);
+        __m256 camX = _mm256_sub_ps(_mm256_div_ps(_mm256_mul_ps(two, _mm256_cvtepi32_ps(xs)), widthF), one);
+        __m256 plane = _mm256_mul_ps(planeHalf, camX);
+        __m256 dirX = _mm256_add_ps(cosA, _mm256_mul_ps(plane, negSinA));
+        __m256 dirY = _mm256_add_ps(sinA, _mm256_mul_ps(plane, cosA));
+
+        __m256 deltaX = _mm256_blendv_ps(_mm256_and_ps(_mm256_div_ps(one, dirX), absMask), far, _mm256_cmp_ps(dirX, zero, _CMP_EQ_OQ));
+        __m256 deltaY = _mm256_blendv_ps(_mm256_and_ps(_mm256_div_ps(one, dirY), absMask), far, _mm256_cmp_ps(dirY, zero, _CMP_EQ_OQ));
+
+        __m256 negX = _mm256_cmp_ps(dirX, zero, _CMP_LT_OQ);
+        __m256 negY = _mm256_cmp_ps(dirY, zero, _CMP_LT_OQ);
+        __m256i stepX = _mm256_blendv_epi8(plusOne, minusOne, _mm256_castps_si256(negX));
+        __m256i stepY = _mm256_blendv_epi8(plusOne, minusOne, _mm256_castps_si256(negY));
+        __m256 sideDistX = _mm256_mul_ps(_mm256_blendv_ps(toHighX, toLowX, negX), deltaX);
+        __m256 sideDistY = _mm256_mul_ps(_mm256_blendv_ps(toHighY, toLowY, negY), deltaY);
+
+        __m256i mapX = _mm256_set1_epi32(basis.mapX);
+        __m256i mapY = _mm256_set1_epi32(basis.mapY);
+        __m256i side = zeroI;
+        __m256i tile = zeroI;
+        __m256i active = allOnes;
+
+        while (!_mm256_testz_si256(active, active))
+        {
+            __m256i stepInX = _mm256_castps_si256(_mm256_cmp_ps(sideDistX, sideDistY, _CMP_LT_OQ));
+            __m256i moveX = _mm256_and_si256(active, stepInX);
+            __m256i moveY = _mm256_andnot_si256(stepInX, active);
+
+            sideDistX = _mm256_blendv_ps(sideDistX, _mm256_add_ps(sideDistX, deltaX), _mm256_castsi256_ps(moveX));
+            sideDistY = _mm256_blendv_ps(sideDistY, _mm256_add_ps(sideDistY, deltaY), _mm256_castsi256_ps(moveY));
+            mapX = _mm256_add_epi32(mapX, _mm256_and_si256(stepX, moveX));
+            mapY = _mm256_add_epi32(mapY, _mm256_and_si256(stepY, moveY));
+            side = _mm256_blendv_epi8(side, _mm256_srli_epi32(moveY, 31), active);
+
+            // gather the 4 bytes ending at the tile (or starting at it for the first 3 tiles), so the
+            // 32-bit gather never reads outside the map, then shift the tile byte down
+            __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(mapY, mapW), mapX);
+            __m256i back = _mm256_and_si256(_mm256_cmpgt_epi32(index, two32), three);
+            __m256i word = _mm256_mask_i32gather_epi32(zeroI, (const int *)map.tiles, _mm256_sub_epi32(index, back), active, 1);
+            __m256i found = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_slli_epi32(back, 3)), byteMask);
+
+            // look its TileOpaque bit up in the 8 words of opaqueBits, in registers
+            __m256i bits = _mm256_permutevar8x32_epi32(opaqueBits, _mm256_srli_epi32(found, 5));
+            bits = _mm256_and_si256(_mm256_srlv_epi32(bits, _mm256_and_si256(found, bitMask)), oneBit);
+            __m256i wall = _mm256_and_si256(_mm256_cmpeq_epi32(bits, oneBit), active);
+            tile = _mm256_blendv_epi8(tile, found, wall);
+            active = _mm256_andnot_si256(wall, active);
+        }
+
+        __m256 sideY = _mm256_castsi256_ps(_mm256_cmpeq_epi32(side, plusOne));
+        __m256 perp = _mm256_blendv_ps(_mm256_sub_ps(sideDistX, deltaX), _mm256_sub_ps(sideDistY, deltaY), sideY);
+        perp = _mm256_max_ps(perp, _mm256_set1_ps(0.0001f));
+
+        // wallX as in FinishHit
+        __m256 wallPos = _mm256_blendv_ps(_mm256_add_ps(posY, _mm256_mul_ps(perp, dirY)),
+                                          _mm256_add_ps(posX, _mm256_mul_ps(perp, dirX)), sideY);
+        __m256 wallX = _mm256_sub_ps(wallPos, _mm256_floor_ps(wallPos));
+
+        alignas(32) float outPerp[8], outDirX[8], outDirY[8], outWallX[8];
+        alignas(32) int outSide[8], outTile[8];
+        _mm256_store_ps(outPerp, perp);
+        _mm256_store_ps(outDirX, dirX);
+        _mm256_store_ps(outDirY, dirY);
+        _mm256_store_ps(outWallX, wallX);
+        _mm256_store_si256((__m256i *)outSide, side);
+        _mm256_store_si256((__m256i *)outTile, tile);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            RayHit &hit = hits[i + lane];
+            hit.perpWallDist = outPerp[lane];
+            hit.dirX = outDirX[lane];
+            hit.dirY = outDirY[lane];
+            hit.wallX = outWallX[lane];
+            hit.side = outSide[lane];
+            hit.tile = (char)outTile[lane];
+        }
+    }
+}
+
+#else
+
+void CastRayPacketsSSE2(const RayBasis &basis, const Map &map, int x0, int count, int width, RayHit *hits)
+{
+    for (int i = 0; i < count; ++i)
+        hits[i] = CastRay(basis, map, x0 + i, width);
+}
+
+void CastRayPacketsAVX2(const RayBasis &basis, const Map &map, int x0, int count, int width, RayHit *hits)
+{
+    CastRayPacketsSSE2(basis, map, x0, count, width, hits);
+}
+
+#endif
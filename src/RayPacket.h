@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Raycaster.h"
+#include <cmath>
+
+// SIMD ray packet kernels behind CastRays. They trace count adjacent columns starting at x0, 4 (SSE2) or
+// 8 (AVX2) at a time, so count must be a multiple of the packet width.
+void CastRayPacketsSSE2(const RayBasis &basis, const Map &map, int x0, int count, int width, RayHit *hits);
+void CastRayPacketsAVX2(const RayBasis &basis, const Map &map, int x0, int count, int width, RayHit *hits);
+
+// fill in wallX of a traced ray. Shared by the scalar and packet paths so both agree exactly
+inline void FinishHit(const RayBasis &basis, RayHit &hit)
+{
+    float wallPos = (hit.side == 0) ? basis.posY + hit.perpWallDist * hit.dirY
+                                    : basis.posX + hit.perpWallDist * hit.dirX;
+    hit.wallX = wallPos - std::floor(wallPos);
+}
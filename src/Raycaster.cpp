@@ -0,0 +1,472 @@
+#include "Raycaster.h"
+#include "Floor.h"
+#include "Profiler.h"
+#include "RayPacket.h"
+#include "Transpose.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+RayBasis::RayBasis(const Camera &camera)
+    : posX(camera.x), posY(camera.y),
+      cosA(std::cos(camera.angle)), sinA(std::sin(camera.angle)),
+      planeHalf(camera.planeHalf),
+      mapX((int)camera.x), mapY((int)camera.y)
+{
+}
+
+RayHit CastRay(const Camera &camera, const Map &map, int x, int width)
+{
+    return CastRay(RayBasis(camera), map, x, width);
+}
+
+RayHit CastRay(const RayBasis &basis, const Map &map, int x, int width)
+{
+    float camX = ((2.0f * x) / (float)width) - 1.0f;
+
+    RayHit ray;
+    ray.dirX = basis.cosA + basis.planeHalf * camX * (-basis.sinA);
+    ray.dirY = basis.sinA + basis.planeHalf * camX * (basis.cosA);
+
+    int mapX = basis.mapX;
+    int mapY = basis.mapY;
+
+    float sideDistX;
+    float sideDistY;
+
+    float deltaDistX = (ray.dirX == 0.0f) ? 1e30f : std::fabs(1.0f / ray.dirX);
+    float deltaDistY = (ray.dirY == 0.0f) ? 1e30f : std::fabs(1.0f / ray.dirY);
+
+    int stepX;
+    int stepY;
+
+    int side = 0;
+    char tile = 0;
+
+    if (ray.dirX < 0)
+    {
+        stepX = -1;
+        sideDistX = (basis.posX - mapX) * deltaDistX;
+    }
+    else
+    {
+        stepX = 1;
+        sideDistX = (mapX + 1.0f - basis.posX) * deltaDistX;
+    }
+
+    if (ray.dirY < 0)
+    {
+        stepY = -1;
+        sideDistY = (basis.posY - mapY) * deltaDistY;
+    }
+    else
+    {
+        stepY = 1;
+        sideDistY = (mapY + 1.0f - basis.posY) * deltaDistY;
+    }
+
+    // the map's edges are walls, so the ray stops at one of them without checking the bounds
+    while (true)
+    {
+        if (sideDistX < sideDistY)
+        {
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            side = 0;
+        }
+        else
+        {
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            side = 1;
+        }
+
+        tile = map.Tile(mapX, mapY);
+        if (map.Info(tile).flags & TileOpaque)
+            break;
+    }
+
+    ray.perpWallDist = (side == 0) ? (sideDistX - deltaDistX) : (sideDistY - deltaDistY);
+    if (ray.perpWallDist < 0.0001f)
+        ray.perpWallDist = 0.0001f;
+    ray.side = side;
+    ray.tile = tile;
+    FinishHit(basis, ray);
+    return ray;
+}
+
+void CastRays(const RayBasis &basis, const Map &map, int x0, int x1, int width, RayHit *hits, SimdLevel level)
+{
+    int x = x0;
+#if RAYCORE_X86
+    level = ClampSimdLevel(level);
+    if (level == SimdLevel::AVX2)
+    {
+        const int count = (x1 - x) & ~7;
+        CastRayPacketsAVX2(basis, map, x, count, width, hits + (x - x0));
+        x += count;
+    }
+    if (level >= SimdLevel::SSE2)
+    {
+        const int count = (x1 - x) & ~3;
+        CastRayPacketsSSE2(basis, map, x, count, width, hits + (x - x0));
+        x += count;
+    }
+#endif
+    for (; x < x1; ++x)
+        hits[x - x0] = CastRay(basis, map, x, width);
+}
+
+float TraceWall(const Map &map, float x, float y, float dirX, float dirY)
+{
+    int mapX = (int)x;
+    int mapY = (int)y;
+    const float deltaDistX = (dirX == 0.0f) ? 1e30f : std::fabs(1.0f / dirX);
+    const float deltaDistY = (dirY == 0.0f) ? 1e30f : std::fabs(1.0f / dirY);
+    const int stepX = dirX < 0 ? -1 : 1;
+    const int stepY = dirY < 0 ? -1 : 1;
+    float sideDistX = dirX < 0 ? (x - mapX) * deltaDistX : (mapX + 1.0f - x) * deltaDistX;
+    float sideDistY = dirY < 0 ? (y - mapY) * deltaDistY : (mapY + 1.0f - y) * deltaDistY;
+
+    while (true)
+    {
+        float distance;
+        if (sideDistX < sideDistY)
+        {
+            distance = sideDistX;
+            sideDistX += deltaDistX;
+            mapX += stepX;
+        }
+        else
+        {
+            distance = sideDistY;
+            sideDistY += deltaDistY;
+            mapY += stepY;
+        }
+        if (map.Info(map.Tile(mapX, mapY)).flags & TileOpaque)
+            return distance;
+    }
+}
+
+// clear the rows of a column that the last span covered but the new one doesn't
+template <typename Pixel>
+static inline void ClearSpanDelta(Pixel *dst, ptrdiff_t pitch, ColumnSpan last, ColumnSpan next)
+{
+    const int aboveEnd = std::min(last.bottom, next.top);
+    for (int y = last.top; y < aboveEnd; ++y)
+        dst[y * pitch] = 0;
+    for (int y = std::max(last.top, next.bottom); y < last.bottom; ++y)
+        dst[y * pitch] = 0;
+}
+
+// where the wall of one screen column lands and how it walks its texture
+struct WallColumn
+{
+    ColumnSpan span;      // rows the wall covers
+    int tile = 0;         // atlas tile
+    int level = 0;        // mip level
+    int texX = 0;         // texture column at that level
+    uint32_t texPos = 0;  // texture row of the first covered row, 16.16 fixed point
+    uint32_t step = 0;    // texture rows per screen row
+    uint32_t texMask = 0; // level size - 1
+};
+
+// lay out the wall of one screen column, textured with atlas tile. With mipmaps the texture is read from
+// the largest level that needs at least one texel per pixel, so far walls read a few neighbouring texels
+// instead of every 8th or 16th one.
+static WallColumn SetupWallColumn(const RayHit &ray, int tile, int height, int tileSize, int levelCount, bool mipmaps)
+{
+    const float halfH = height * 0.5f;
+
+    int lineHeight = (int)(height / ray.perpWallDist);
+    int drawStart = -lineHeight / 2 + (int)halfH;
+    int drawEnd = lineHeight / 2 + (int)halfH;
+    if (drawStart < 0)
+        drawStart = 0;
+    if (drawEnd >= height)
+        drawEnd = height - 1;
+
+    // the wall covers the rows strictly between drawStart and drawEnd
+    WallColumn wall;
+    wall.span.top = drawStart + 1;
+    wall.span.bottom = std::max(drawEnd, wall.span.top);
+    if (wall.span.top >= wall.span.bottom)
+        return wall;
+
+    wall.tile = tile;
+
+    if (mipmaps)
+        while (wall.level + 1 < levelCount && (tileSize >> (wall.level + 1)) >= lineHeight)
+            ++wall.level;
+    const int texSize = tileSize >> wall.level;
+    wall.texMask = (uint32_t)texSize - 1;
+
+    int texX = int(ray.wallX * double(tileSize));
+    if (ray.side == 0 && ray.dirX > 0)
+        texX = tileSize - texX - 1;
+    if (ray.side == 1 && ray.dirY < 0)
+        texX = tileSize - texX - 1;
+    wall.texX = texX >> wall.level;
+
+    // texture rows in 16.16 fixed point. The start is computed in 64 bits from the unclipped wall top, so
+    // it stays exact for walls that are many times taller than the screen
+    wall.step = (uint32_t)(((int64_t)texSize << 16) / lineHeight);
+    wall.texPos = (uint32_t)((int64_t)(drawStart - height / 2 + lineHeight / 2) * ((int64_t)texSize << 16) / lineHeight);
+    return wall;
+}
+
+// count the texels a wall column reads and the 64 byte lines they touch. Every row is one fetch. Below
+// a line's worth of texels per step the reads walk through every line between the first and last one,
+// above it each read is a line of its own
+static void CountTexelReads(const WallColumn &wall, int texelsPerLine, RenderStats &stats)
+{
+    const int rows = wall.span.bottom - wall.span.top;
+    const int firstRow = (wall.texPos >> 16) & wall.texMask;
+    const int lastRow = ((wall.texPos + (uint32_t)(rows - 1) * wall.step) >> 16) & wall.texMask;
+    stats.texelFetches += rows;
+    if (wall.step < (uint32_t)texelsPerLine << 16)
+        stats.texelLines += std::abs(lastRow / texelsPerLine - firstRow / texelsPerLine) + 1;
+    else
+        stats.texelLines += rows;
+}
+
+// draw the textured wall span of one screen column. dst points at the column's top pixel and pitch is the
+// distance between two pixels of the column (1 for column-major, width for row-major). Only the wall
+// span and the part of last frame's span it no longer covers are written.
+static void DrawWallColumn(const RayHit &ray, const TileInfo &info, const TextureAtlas &atlas, int height,
+                           bool mipmaps, uint32_t *dst, ptrdiff_t pitch, ColumnSpan &span, RenderStats &stats)
+{
+    const WallColumn wall = SetupWallColumn(ray, info.texture, height, atlas.tileSize, atlas.levelCount, mipmaps);
+    ClearSpanDelta(dst, pitch, span, wall.span);
+    span = wall.span;
+    if (span.top >= span.bottom)
+        return;
+    CountTexelReads(wall, 64 / sizeof(uint32_t), stats);
+
+    float shade = (ray.side == 1) ? info.shade / 256.0f : 1.0f;
+
+    const uint32_t *texColumn = atlas.Column(wall.tile, wall.texX, wall.level);
+
+    uint32_t texPos = wall.texPos;
+    uint32_t *pixel = dst + span.top * pitch;
+    for (int y = span.top; y < span.bottom; ++y, pixel += pitch)
+    {
+        int texY = (texPos >> 16) & wall.texMask;
+        texPos += wall.step;
+
+        uint32_t texel = texColumn[texY];
+        uint8_t b = uint8_t((texel & 0xFF) * shade);
+        uint8_t g = uint8_t(((texel >> 8) & 0xFF) * shade);
+        uint8_t r = uint8_t(((texel >> 16) & 0xFF) * shade);
+
+        *pixel = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+}
+
+// light level of a wall column: the side shading of DrawWallColumn, faded out toward fogDistance
+static int WallLight(const RayHit &ray, const TileInfo &info, float fogDistance)
+{
+    float light = (ray.side == 1) ? info.shade / 256.0f : 1.0f;
+    if (fogDistance > 0.0f)
+        light *= std::max(0.0f, 1.0f - ray.perpWallDist / fogDistance);
+    return (int)(light * (lightLevels - 1) + 0.5f);
+}
+
+// DrawWallColumn for the indexed layout: palette indices into an 8-bit column, shaded and fogged by the
+// colormap of the column's light level
+static void DrawIndexedWallColumn(const RayHit &ray, const TileInfo &info, const IndexedAtlas &atlas,
+                                  const uint8_t *colormap, int height, bool mipmaps, uint8_t *dst, ColumnSpan &span,
+                                  RenderStats &stats)
+{
+    const WallColumn wall = SetupWallColumn(ray, info.texture, height, atlas.tileSize, atlas.levelCount, mipmaps);
+    ClearSpanDelta(dst, 1, span, wall.span);
+    span = wall.span;
+    if (span.top >= span.bottom)
+        return;
+    CountTexelReads(wall, 64, stats);
+
+    const uint8_t *texColumn = atlas.Column(wall.tile, wall.texX, wall.level);
+
+    uint32_t texPos = wall.texPos;
+    for (int y = span.top; y < span.bottom; ++y)
+    {
+        dst[y] = colormap[texColumn[(texPos >> 16) & wall.texMask]];
+        texPos += wall.step;
+    }
+}
+
+// columns per band. A multiple of the cache line in pixels, and the depth buffer and the rows of the
+// frame start on cache lines, so neighbouring bands never write to the same cache line of either
+static int BandWidth(int width, int threads)
+{
+    const int align = Framebuffer::cacheLinePixels;
+    const int bands = threads > 1 ? threads * 4 : 1; // a few bands per thread to even out the load
+    int bandWidth = (width + bands - 1) / bands;
+    bandWidth = (bandWidth + align - 1) / align * align;
+    return bandWidth > 0 ? bandWidth : align;
+}
+
+void RenderFrame(const Camera &camera, const Map &map, const TextureAtlas &atlas, Framebuffer &fb,
+                 const RenderOptions &options)
+{
+    PROFILE_ZONE("RenderFrame");
+    using Clock = std::chrono::steady_clock;
+
+    const int width = fb.width;
+    const int height = fb.height;
+
+    // the indexed layout needs the palette textures, without them it falls back to column-major
+    FramebufferLayout layout = options.layout;
+    if (layout == FramebufferLayout::IndexedColumns && !options.indexed)
+        layout = FramebufferLayout::ColumnMajor;
+    const bool columnMajor = layout == FramebufferLayout::ColumnMajor;
+    const bool indexed = layout == FramebufferLayout::IndexedColumns;
+
+    // the span records describe one buffer. After a layout switch the other buffers hold stale spans
+    // (and the transposed output a stale frame), so clear everything once
+    if (fb.spanLayout != layout)
+    {
+        std::fill(fb.pixelStorage.begin(), fb.pixelStorage.end(), 0x00);
+        std::fill(fb.columnStorage.begin(), fb.columnStorage.end(), 0x00);
+        std::fill(fb.indexStorage.begin(), fb.indexStorage.end(), 0x00);
+        std::fill(fb.spans.begin(), fb.spans.end(), ColumnSpan());
+        fb.spanLayout = layout;
+        fb.floorDrawn = false;
+        fb.MarkDirtyRows(0, height);
+    }
+
+    // the textured floor is redrawn every frame but never cleared, so going back to flat clears it once
+    const bool texturedFloor = options.floor == FloorMode::Textured;
+    if (fb.floorDrawn && !texturedFloor)
+    {
+        std::fill(fb.pixelStorage.begin(), fb.pixelStorage.end(), 0x00);
+        fb.MarkDirtyRows(0, height);
+    }
+    fb.floorDrawn = texturedFloor;
+    if (texturedFloor)
+        fb.MarkDirtyRows(0, height);
+
+    // rays rely on the walls around the map to stop, so they have to start inside them. The player can't
+    // get there; this only keeps a stray camera from reading outside the map
+    Camera inside = camera;
+    inside.x = std::min(std::max(camera.x, 1.0f), std::nextafter(map.width - 1.0f, 0.0f));
+    inside.y = std::min(std::max(camera.y, 1.0f), std::nextafter(map.height - 1.0f, 0.0f));
+    const RayBasis basis(inside);
+
+    const int threads = options.pool ? options.pool->ThreadCount() : 1;
+    const int bandWidth = BandWidth(width, threads);
+    const int bandCount = (width + bandWidth - 1) / bandWidth;
+
+    // per band timings and changed rows, summed after the bands are done
+    std::vector<RenderStats> &bandStats = fb.bandStats;
+    std::vector<ColumnSpan> &bandDirty = fb.bandDirty;
+    bandStats.resize(options.stats ? bandCount : 0);
+    bandDirty.resize(bandCount);
+
+    // every column only reads the map, camera and atlas and writes its own pixels and depth, so bands
+    // give the same result in any order and on any thread
+    auto renderBand = [&](int band) {
+        const auto wallStart = Clock::now();
+        const int x0 = band * bandWidth;
+        const int x1 = std::min(x0 + bandWidth, width);
+
+        RenderStats counters;
+
+        // rows touched by this band this frame or last frame; nothing outside them changed
+        int dirtyTop = height;
+        int dirtyBottom = 0;
+
+        // trace a chunk of rays as packets, then draw their columns
+        {
+            PROFILE_ZONE("Walls");
+            RayHit hits[64];
+            for (int chunk = x0; chunk < x1; chunk += 64)
+            {
+                const int chunkEnd = std::min(chunk + 64, x1);
+                CastRays(basis, map, chunk, chunkEnd, width, hits, options.simd);
+
+                for (int x = chunk; x < chunkEnd; ++x)
+                {
+                    const RayHit &ray = hits[x - chunk];
+                    const TileInfo &info = map.Info(ray.tile);
+                    ColumnSpan &span = fb.spans[x];
+                    dirtyTop = std::min(dirtyTop, span.top);
+                    dirtyBottom = std::max(dirtyBottom, span.bottom);
+
+                    if (indexed)
+                    {
+                        const uint8_t *colormap = options.indexed->palette.Colormap(WallLight(ray, info, options.fogDistance));
+                        DrawIndexedWallColumn(ray, info, options.indexed->atlas, colormap, height, options.mipmaps,
+                                              fb.IndexColumn(x), span, counters);
+                    }
+                    else if (columnMajor)
+                        DrawWallColumn(ray, info, atlas, height, options.mipmaps, fb.Column(x), 1, span, counters);
+                    else
+                        DrawWallColumn(ray, info, atlas, height, options.mipmaps, fb.Pixels() + x, fb.pitch, span, counters);
+
+                    dirtyTop = std::min(dirtyTop, span.top);
+                    dirtyBottom = std::max(dirtyBottom, span.bottom);
+
+                    fb.Depth()[x] = ray.perpWallDist;
+                }
+            }
+        }
+
+        // transpose (and expand palette indices) while the band's columns are still in cache
+        const auto transposeStart = Clock::now();
+        if (columnMajor && dirtyTop < dirtyBottom)
+        {
+            PROFILE_ZONE("Transpose");
+            TransposeColumns(fb.Column(0), fb.columnPitch, fb.Pixels(), fb.pitch, x0, x1, dirtyTop, dirtyBottom, options.simd);
+        }
+        if (indexed && dirtyTop < dirtyBottom)
+        {
+            PROFILE_ZONE("Expand");
+            ExpandIndexedColumns(fb.IndexColumn(0), fb.indexPitch, options.indexed->palette.colors, fb.Pixels(), fb.pitch,
+                                 x0, x1, dirtyTop, dirtyBottom, options.simd);
+        }
+
+        bandDirty[band].top = dirtyTop;
+        bandDirty[band].bottom = dirtyBottom;
+
+        // then the floor and ceiling around the finished walls
+        const auto floorStart = Clock::now();
+        if (texturedFloor)
+        {
+            PROFILE_ZONE("Floor");
+            CastFloorColumns(basis, atlas, (int)map.floor, (int)map.ceiling, options.mipmaps, fb, x0, x1, options.simd);
+        }
+
+        if (options.stats)
+        {
+            const auto end = Clock::now();
+            bandStats[band] = counters;
+            bandStats[band].wallMs = std::chrono::duration<double, std::milli>(transposeStart - wallStart).count();
+            bandStats[band].transposeMs = std::chrono::duration<double, std::milli>(floorStart - transposeStart).count();
+            bandStats[band].floorMs = std::chrono::duration<double, std::milli>(end - floorStart).count();
+        }
+    };
+
+    if (options.pool)
+        options.pool->ParallelFor(bandCount, renderBand);
+    else
+        for (int band = 0; band < bandCount; ++band)
+            renderBand(band);
+
+    for (const ColumnSpan &rows : bandDirty)
+        fb.MarkDirtyRows(rows.top, rows.bottom);
+
+    if (options.stats)
+    {
+        *options.stats = RenderStats();
+        for (const RenderStats &band : bandStats)
+        {
+            options.stats->wallMs += band.wallMs;
+            options.stats->transposeMs += band.transposeMs;
+            options.stats->floorMs += band.floorMs;
+            options.stats->texelFetches += band.texelFetches;
+            options.stats->texelLines += band.texelLines;
+        }
+    }
+}
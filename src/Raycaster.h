@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Map.h"
+#include "Texture.h"
+#include "Palette.h"
+#include "Framebuffer.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+// point of view the frame is rendered from
+struct Camera
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float angle = 0.0f;     // radians
+    float planeHalf = 0.0f; // half width of the camera plane, tan(fov / 2)
+};
+
+// result of casting a single ray through the map
+struct RayHit
+{
+    float perpWallDist = 0.0f; // distance to the wall, perpendicular to the camera plane
+    float dirX = 0.0f;         // ray direction
+    float dirY = 0.0f;
+    float wallX = 0.0f;        // where the wall was hit, 0..1 along the wall
+    int side = 0;              // 0 = hit a wall facing x, 1 = hit a wall facing y
+    char tile = 0;             // map tile that was hit
+};
+
+// per-frame values every ray of a camera shares, computed once instead of once per column
+struct RayBasis
+{
+    float posX = 0.0f;
+    float posY = 0.0f;
+    float cosA = 0.0f;
+    float sinA = 0.0f;
+    float planeHalf = 0.0f;
+    int mapX = 0; // tile the camera stands in
+    int mapY = 0;
+
+    explicit RayBasis(const Camera &camera);
+};
+
+// how the floor and ceiling are drawn
+enum class FloorMode
+{
+    Flat,     // left transparent (0) for flat colours drawn underneath
+    Textured, // cast from the atlas with the map's floor and ceiling textures
+};
+
+struct RenderOptions
+{
+    FramebufferLayout layout = FramebufferLayout::ColumnMajor;
+    SimdLevel simd = BestSimdLevel(); // highest instruction set the kernels may use
+    FloorMode floor = FloorMode::Flat;
+    const IndexedTextures *indexed = nullptr; // palette and indexed atlas for FramebufferLayout::IndexedColumns
+    float fogDistance = 0.0f;                 // indexed walls fade into the palette's fog colour this far away, 0 for none
+    bool mipmaps = true;              // sample distant walls and floors from the smaller mip levels of the atlas
+    ThreadPool *pool = nullptr;       // split the screen into column bands across these threads, serial if null
+    RenderStats *stats = nullptr;     // filled in if set
+};
+
+// cast the ray of screen column x with DDA until it hits a wall. There are no bounds checks: the camera has
+// to be inside the walls around the map
+RayHit CastRay(const Camera &camera, const Map &map, int x, int width);
+RayHit CastRay(const RayBasis &basis, const Map &map, int x, int width);
+
+// cast the rays of screen columns [x0, x1) into hits[0 .. x1 - x0). With SSE2 or AVX2 allowed, 4 or 8
+// adjacent columns are traced together as a packet; the hits are identical to CastRay's
+void CastRays(const RayBasis &basis, const Map &map, int x0, int x1, int width, RayHit *hits, SimdLevel level);
+
+// distance from x, y along the unit direction dirX, dirY to the first wall, walked with CastRay's DDA. Like
+// it, no bounds checks: the start has to be inside the walls around the map
+float TraceWall(const Map &map, float x, float y, float dirX, float dirY);
+
+// render the textured walls of a frame into fb.Pixels() and fb.Depth(). Pixels without a wall are left
+// transparent (0) for the ceiling and floor drawn underneath, unless options.floor textures them too
+void RenderFrame(const Camera &camera, const Map &map, const TextureAtlas &atlas, Framebuffer &fb,
+                 const RenderOptions &options = RenderOptions());
@@ -0,0 +1,59 @@
+#include "Simd.h"
+
+#if RAYCORE_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+static SimdLevel DetectSimdLevel()
+{
+#if RAYCORE_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return SimdLevel::SSE2;
+
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+    // the OS also has to save the YMM registers on context switches
+    if (osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6)
+        return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel BestSimdLevel()
+{
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+SimdLevel ClampSimdLevel(SimdLevel requested)
+{
+    SimdLevel best = BestSimdLevel();
+    return (int)requested < (int)best ? requested : best;
+}
+
+const char *SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE2:
+        return "SSE2";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
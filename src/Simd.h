@@ -0,0 +1,33 @@
+#pragma once
+
+// SIMD support shared by the renderer kernels. x86-64 always has SSE2; AVX2 kernels are compiled with a
+// per-function target attribute and only called after checking the CPU at runtime, so a default build
+// runs everywhere and still uses AVX2 where available.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RAYCORE_X86 1
+#include <immintrin.h>
+#else
+#define RAYCORE_X86 0
+#endif
+
+#if RAYCORE_X86 && (defined(__GNUC__) || defined(__clang__))
+#define RAYCORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RAYCORE_TARGET_AVX2
+#endif
+
+enum class SimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+// best instruction set the current CPU supports (detected once)
+SimdLevel BestSimdLevel();
+
+// highest level that is both requested and supported
+SimdLevel ClampSimdLevel(SimdLevel requested);
+
+const char *SimdLevelName(SimdLevel level);
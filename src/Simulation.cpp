@@ -0,0 +1,102 @@
+#include "Simulation.h"
+#include <cmath>
+#include "Profiler.h"
+#include "raycastTest.h"
+
+void Simulation::Reset(uint32_t seed)
+{
+    player = Player();
+    player.pos = {GetWorldMap().startX, GetWorldMap().startY};
+    gameClear = false;
+    weapon.Reset();
+    enemyManager.Reset();
+    enemyManager.Seed(seed);
+    enemyManager.InitializeTargets(5, player.pos);
+}
+
+void Simulation::Step(const FrameInput &input)
+{
+    const float dt = input.dt;
+    const float mouseSensitivity = 0.0025f;
+    player.angle += input.mouseDx * mouseSensitivity;
+
+    D2D_POINT_2F forward = {std::cos(player.angle), std::sin(player.angle)};
+    D2D_POINT_2F right = {-std::sin(player.angle), std::cos(player.angle)};
+    D2D_POINT_2F desired = {0.0f, 0.0f};
+
+    // the weapon fires at its own rate however long the frames are, each shot all of its pellets at once
+    const int shots = weapon.Trigger(dt, (input.buttons & ButtonFire) != 0);
+    for (int shot = 0; shot < shots && !gameClear; ++shot)
+    {
+        {
+            PROFILE_ZONE("Weapon::Fire");
+            weapon.Fire(enemyManager, player.pos, player.angle, pelletHits);
+        }
+
+        // walls stop the pellets, and the hit enemies are removed by their handles. Pellets hitting the
+        // same enemy find it gone
+        bool destroyed = false;
+        for (const PelletHit &hit : pelletHits)
+        {
+            if (enemyManager.RemoveEnemy(hit.enemy))
+            {
+                SDL_Log("Enemy destroyed at distance: %f", hit.distance);
+                destroyed = true;
+            }
+        }
+
+        if (destroyed && enemyManager.CountTargets() == 0)
+        {
+            gameClear = true;
+            enemyManager.SetSpawningEnabled(false);
+            enemyManager.DestroyAllEnemies();
+            SDL_Log("Game Clear: All targets destroyed. Enemies stopped and cleared.");
+        }
+    }
+
+    if (input.buttons & ButtonForward)
+    {
+        desired.x += forward.x;
+        desired.y += forward.y;
+    }
+    if (input.buttons & ButtonBack)
+    {
+        desired.x -= forward.x;
+        desired.y -= forward.y;
+    }
+    if (input.buttons & ButtonStrafeLeft)
+    {
+        desired.x -= right.x;
+        desired.y -= right.y;
+    }
+    if (input.buttons & ButtonStrafeRight)
+    {
+        desired.x += right.x;
+        desired.y += right.y;
+    }
+    if (input.buttons & ButtonTurnLeft)
+        player.angle -= player.rotSpeed * dt;
+    if (input.buttons & ButtonTurnRight)
+        player.angle += player.rotSpeed * dt;
+
+    float len = std::sqrt(desired.x * desired.x + desired.y * desired.y);
+    if (len > 0.0001f)
+    {
+        desired.x /= len;
+        desired.y /= len;
+    }
+
+    D2D_POINT_2F nextPos = {player.pos.x + desired.x * player.moveSpeed * dt,
+                            player.pos.y + desired.y * player.moveSpeed * dt};
+
+    D2D_POINT_2F playerSize = {0.35f, 0.35f};
+    {
+        PROFILE_ZONE("canMove");
+        if (canMove(nextPos, playerSize))
+        {
+            player.pos = nextPos;
+        }
+    }
+
+    enemyManager.Update(dt, player.pos);
+}
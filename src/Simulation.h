@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include "EnemyManager.h"
+#include "Player.h"
+#include "Weapon.h"
+
+// buttons held during a frame
+enum InputButton : uint8_t
+{
+    ButtonForward = 1 << 0,
+    ButtonBack = 1 << 1,
+    ButtonStrafeLeft = 1 << 2,
+    ButtonStrafeRight = 1 << 3,
+    ButtonTurnLeft = 1 << 4,
+    ButtonTurnRight = 1 << 5,
+    ButtonFire = 1 << 6,
+};
+
+// everything the simulation reads in one frame
+struct FrameInput
+{
+    float dt = 0.0f;      // seconds since the last frame
+    float mouseDx = 0.0f; // relative mouse motion summed over the frame
+    uint8_t buttons = 0;  // InputButton bits
+};
+
+// the player and enemies, only advanced by Step, so the same seed and inputs always play the same game
+class Simulation
+{
+public:
+    Player player;
+    EnemyManager enemyManager;
+    Weapon weapon; // fires while ButtonFire is held
+    bool gameClear = false;
+
+    // start a new game: the player at the start position and the targets placed from seed
+    void Reset(uint32_t seed);
+
+    void Step(const FrameInput &input);
+
+private:
+    std::vector<PelletHit> pelletHits; // of the last shot
+};
@@ -0,0 +1,172 @@
+#include "Sprites.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+void SpriteRuns::Build(const TextureAtlas &atlas)
+{
+    tileSize = atlas.tileSize;
+    const int columns = atlas.tileCount * tileSize;
+    columnStart.assign(columns + 1, 0);
+    runs.clear();
+
+    for (int column = 0; column < columns; ++column)
+    {
+        columnStart[column] = (uint32_t)runs.size();
+        const uint32_t *texels = atlas.Column(column / tileSize, column % tileSize);
+        for (int y = 0; y < tileSize;)
+        {
+            if (IsColorKey(texels[y]))
+            {
+                ++y;
+                continue;
+            }
+            SpriteRun run;
+            run.top = (uint16_t)y;
+            while (y < tileSize && !IsColorKey(texels[y]))
+                ++y;
+            run.bottom = (uint16_t)y;
+            runs.push_back(run);
+        }
+    }
+    columnStart[columns] = (uint32_t)runs.size();
+}
+
+static inline int64_t CeilDiv(int64_t n, int64_t d) { return n >= 0 ? (n + d - 1) / d : -(-n / d); }
+
+// screen row of a sprite where the texture row reaches texRow, the inverse of the texY mapping in
+// DrawSprites (texY = ((d * tileSize) / spriteHeight) / 256 with d = sy * 256 - height * 128 + spriteHeight * 128)
+static int FirstScreenRow(int texRow, int tileSize, int spriteHeight, int height)
+{
+    if (texRow <= 0)
+        return INT_MIN;
+    if (texRow >= tileSize)
+        return INT_MAX; // texY is clamped below tileSize
+    const int64_t d = CeilDiv((int64_t)256 * texRow * spriteHeight, tileSize);
+    return (int)CeilDiv(d + (int64_t)128 * height - (int64_t)128 * spriteHeight, 256);
+}
+
+static void DrawProjectedSprite(const ProjectedSprite &sprite, const TextureAtlas &atlas, const SpriteRuns &runs,
+                                Framebuffer &fb)
+{
+    const int height = fb.height;
+    const int tileSize = atlas.tileSize;
+    const int spriteHeight = sprite.size;
+    const int spriteWidth = sprite.size; // square
+    const int drawTop = sprite.top;
+    const int drawBottom = sprite.bottom;
+    const float cx = sprite.distance;
+    const int tile = sprite.tile;
+    const DepthPyramid &pyramid = fb.depthPyramid;
+
+    int dirtyTop = height;
+    int dirtyBottom = 0;
+    // columns entirely behind a wall are skipped a block at a time, unless no wall in the range is nearer
+    for (int sx = sprite.needsDepthTest ? pyramid.NextVisible(sprite.left, cx) : sprite.left; sx <= sprite.right;
+         sx = sprite.needsDepthTest ? pyramid.NextVisible(sx + 1, cx) : sx + 1)
+    {
+        int texX = int(256 * (sx - (-spriteWidth / 2 + sprite.screenX)) * tileSize / spriteWidth) / 256;
+        texX = std::clamp(texX, 0, tileSize - 1);
+
+        const SpriteRun *run = runs.Begin(tile, texX);
+        const SpriteRun *end = runs.End(tile, texX);
+        if (run == end)
+            continue;
+
+        // blit the opaque runs of the column, each one a contiguous strip of the texture
+        const uint32_t *texColumn = atlas.Column(tile, texX);
+        int columnTop = height;
+        int columnBottom = 0;
+        for (; run != end; ++run)
+        {
+            const int y0 = std::max(drawTop, FirstScreenRow(run->top, tileSize, spriteHeight, height));
+            const int y1 = std::min(drawBottom + 1, FirstScreenRow(run->bottom, tileSize, spriteHeight, height));
+            if (y0 >= y1)
+                continue;
+            columnTop = std::min(columnTop, y0);
+            columnBottom = y1;
+
+            int d = y0 * 256 - height * 128 + spriteHeight * 128; // 256 and 128 factors to avoid floats
+            uint32_t *pixel = fb.Row(y0) + sx;
+            for (int sy = y0; sy < y1; ++sy, d += 256, pixel += fb.pitch)
+            {
+                int texY = std::clamp(((d * tileSize) / spriteHeight) / 256, 0, tileSize - 1);
+                *pixel = 0xFF000000 | texColumn[texY];
+            }
+        }
+        if (columnTop >= columnBottom)
+            continue;
+
+        // the next frame has to restore these rows
+        ColumnSpan &span = fb.spans[sx];
+        span.top = std::min(span.top, columnTop);
+        span.bottom = std::max(span.bottom, columnBottom);
+        dirtyTop = std::min(dirtyTop, columnTop);
+        dirtyBottom = std::max(dirtyBottom, columnBottom);
+    }
+
+    fb.MarkDirtyRows(dirtyTop, dirtyBottom);
+}
+
+int DrawSprites(const Camera &camera, const std::vector<Sprite> &sprites, const TextureAtlas &atlas,
+                const SpriteRuns &runs, Framebuffer &fb)
+{
+    PROFILE_ZONE("Sprites");
+    const int width = fb.width;
+    const int height = fb.height;
+    const float halfH = height * 0.5f;
+
+    // camera space is the same for every sprite
+    const float sinA = std::sin(camera.angle);
+    const float cosA = std::cos(camera.angle);
+
+    fb.depthPyramid.Build(fb.Depth(), width);
+
+    std::vector<ProjectedSprite> &visible = fb.visibleSprites;
+    visible.clear();
+    for (size_t i = 0; i < sprites.size(); ++i)
+    {
+        const Sprite &sprite = sprites[i];
+        float dxw = sprite.x - camera.x;
+        float dyw = sprite.y - camera.y;
+        float cx = dxw * cosA + dyw * sinA;  // forward
+        float cy = -dxw * sinA + dyw * cosA; // right
+
+        if (cx <= 0.1f)
+            continue; // behind the camera
+
+        ProjectedSprite p;
+        p.distance = cx;
+        p.screenX = (width / 2.0f) * (1.0f + (cy / (cx * camera.planeHalf)));
+        p.size = (int)(height / cx);
+        p.top = (int)(halfH - p.size / 2.0f);
+        p.bottom = (int)(halfH + p.size / 2.0f);
+        int drawLeft = (int)(p.screenX - p.size / 2.0f);
+        int drawRight = (int)(p.screenX + p.size / 2.0f);
+
+        if (drawRight < 0 || drawLeft >= width || p.size <= 0)
+            continue;
+        p.top = std::max(p.top, 0);
+        p.bottom = std::min(p.bottom, height - 1);
+        p.left = std::max(drawLeft, 0);
+        p.right = std::min(drawRight, width - 1);
+
+        float nearest, farthest;
+        fb.depthPyramid.Range(p.left, p.right, nearest, farthest);
+        if (cx >= farthest)
+            continue; // behind the walls across its whole width
+        p.needsDepthTest = cx >= nearest;
+        p.tile = (int)sprite.texture;
+        p.order = (uint32_t)i;
+        visible.push_back(p);
+    }
+
+    // back to front, so nearer sprites cover farther ones
+    std::sort(visible.begin(), visible.end(), [](const ProjectedSprite &a, const ProjectedSprite &b) {
+        return a.distance != b.distance ? a.distance > b.distance : a.order < b.order;
+    });
+    for (const ProjectedSprite &sprite : visible)
+        DrawProjectedSprite(sprite, atlas, runs, fb);
+    return (int)visible.size();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include "Raycaster.h"
+
+// a billboard standing on the floor, always facing the camera
+struct Sprite
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    SpriteTexture texture = SpriteTexture::Walker;
+};
+
+// texel rows [top, bottom) of an atlas column that aren't the transparent colour key
+struct SpriteRun
+{
+    uint16_t top = 0;
+    uint16_t bottom = 0;
+};
+
+// the opaque runs of every column of every atlas tile, found once at load time so sprites only blit what
+// they draw instead of testing every texel against the colour key
+struct SpriteRuns
+{
+    int tileSize = 0;
+    std::vector<uint32_t> columnStart; // first run of column (tile * tileSize + x), one extra entry at the end
+    std::vector<SpriteRun> runs;
+
+    void Build(const TextureAtlas &atlas);
+
+    const SpriteRun *Begin(int tile, int x) const { return runs.data() + columnStart[(size_t)tile * tileSize + x]; }
+    const SpriteRun *End(int tile, int x) const { return runs.data() + columnStart[(size_t)tile * tileSize + x + 1]; }
+};
+
+// composite sprites into fb.Pixels() back to front, hidden behind walls closer than them (fb.Depth()). Sprites
+// entirely behind walls are culled against a depth pyramid before sorting. Call after RenderFrame. The rows
+// they cover are added to the column spans, so the next RenderFrame clears or redraws them, and to the
+// framebuffer's dirty rows. Returns how many sprites survived culling.
+int DrawSprites(const Camera &camera, const std::vector<Sprite> &sprites, const TextureAtlas &atlas,
+                const SpriteRuns &runs, Framebuffer &fb);
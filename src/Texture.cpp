@@ -0,0 +1,227 @@
+#include "Texture.h"
+#include <cstdio>
+#include <cstring>
+
+
+static inline uint32_t ReadU32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static inline uint16_t ReadU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static inline void WriteU32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+static inline void WriteU16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+// extract a channel described by a BI_BITFIELDS mask and scale it to 8 bits
+static inline uint32_t ExtractChannel(uint32_t value, uint32_t mask)
+{
+    if (mask == 0)
+        return 0xFF;
+    int shift = 0;
+    while (((mask >> shift) & 1) == 0)
+        ++shift;
+    uint32_t bits = mask >> shift;
+    uint32_t v = (value & mask) >> shift;
+    return bits == 0xFF ? v : (v * 255 + bits / 2) / bits;
+}
+
+bool LoadBMP(const char *path, Image &out)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "LoadBMP: can't open %s\n", path);
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+
+    if (data.size() < 54 || data[0] != 'B' || data[1] != 'M')
+    {
+        fprintf(stderr, "LoadBMP: %s is not a BMP file\n", path);
+        return false;
+    }
+
+    const uint32_t pixelOffset = ReadU32(&data[10]);
+    const uint32_t headerSize = ReadU32(&data[14]);
+    const int width = (int)ReadU32(&data[18]);
+    const int rawHeight = (int)ReadU32(&data[22]);
+    const int bpp = ReadU16(&data[28]);
+    const uint32_t compression = ReadU32(&data[30]);
+
+    const bool topDown = rawHeight < 0;
+    const int height = topDown ? -rawHeight : rawHeight;
+
+    if ((bpp != 24 && bpp != 32) || (compression != 0 && compression != 3) || width <= 0 || height <= 0)
+    {
+        fprintf(stderr, "LoadBMP: %s has an unsupported format (%d bpp, compression %u)\n", path, bpp, compression);
+        return false;
+    }
+
+    // default masks for BI_RGB; BI_BITFIELDS stores its own right after the info header
+    uint32_t maskR = 0x00FF0000, maskG = 0x0000FF00, maskB = 0x000000FF, maskA = 0;
+    if (compression == 3 && data.size() >= 14 + 40 + 12)
+    {
+        maskR = ReadU32(&data[54]);
+        maskG = ReadU32(&data[58]);
+        maskB = ReadU32(&data[62]);
+        if (headerSize >= 56 && data.size() >= 14 + 40 + 16)
+            maskA = ReadU32(&data[66]);
+    }
+    else if (bpp == 32 && headerSize >= 56)
+    {
+        maskA = 0xFF000000;
+    }
+
+    const int bytesPerPixel = bpp / 8;
+    const size_t rowSize = ((size_t)width * bytesPerPixel + 3) & ~(size_t)3;
+    if (pixelOffset + rowSize * height > data.size())
+    {
+        fprintf(stderr, "LoadBMP: %s is truncated\n", path);
+        return false;
+    }
+
+    out.width = width;
+    out.height = height;
+    out.texels.resize((size_t)width * height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        // BMP rows are stored bottom-up unless the height is negative
+        const uint8_t *row = &data[pixelOffset + rowSize * (topDown ? y : height - 1 - y)];
+        uint32_t *dst = &out.texels[(size_t)y * width];
+        for (int x = 0; x < width; ++x)
+        {
+            const uint8_t *p = row + x * bytesPerPixel;
+            if (bpp == 24)
+            {
+                dst[x] = 0xFF000000 | (p[2] << 16) | (p[1] << 8) | p[0];
+                continue;
+            }
+            uint32_t v = ReadU32(p);
+            dst[x] = (ExtractChannel(v, maskA) << 24) | (ExtractChannel(v, maskR) << 16) |
+                     (ExtractChannel(v, maskG) << 8) | ExtractChannel(v, maskB);
+        }
+    }
+    return true;
+}
+
+bool SaveBMP(const char *path, const uint32_t *pixels, int width, int height, size_t pitch)
+{
+    const uint32_t headerSize = 14 + 40;
+    const uint32_t imageSize = (uint32_t)width * height * 4;
+
+    std::vector<uint8_t> data(headerSize + imageSize, 0);
+    data[0] = 'B';
+    data[1] = 'M';
+    WriteU32(&data[2], headerSize + imageSize);
+    WriteU32(&data[10], headerSize);
+    WriteU32(&data[14], 40);
+    WriteU32(&data[18], (uint32_t)width);
+    WriteU32(&data[22], (uint32_t)-height); // top-down
+    WriteU16(&data[26], 1);
+    WriteU16(&data[28], 32);
+    WriteU32(&data[34], imageSize);
+    for (int y = 0; y < height; ++y)
+        memcpy(&data[headerSize + (size_t)y * width * 4], pixels + y * pitch, (size_t)width * 4);
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "SaveBMP: can't open %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+// average 2x2 blocks of a column-major tile into the next smaller mip level, per channel with rounding
+static void Downsample(const uint32_t *src, int srcSize, uint32_t *dst)
+{
+    const int dstSize = srcSize / 2;
+    for (int x = 0; x < dstSize; ++x)
+    {
+        const uint32_t *left = src + (size_t)(2 * x) * srcSize;
+        const uint32_t *right = left + srcSize;
+        uint32_t *column = dst + (size_t)x * dstSize;
+        for (int y = 0; y < dstSize; ++y)
+        {
+            const uint32_t quad[4] = {left[2 * y], left[2 * y + 1], right[2 * y], right[2 * y + 1]};
+            uint32_t texel = 0;
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                uint32_t sum = 2;
+                for (uint32_t t : quad)
+                    sum += (t >> shift) & 0xFF;
+                texel |= (sum / 4) << shift;
+            }
+            column[y] = texel;
+        }
+    }
+}
+
+bool TextureAtlas::Build(const Image &image, int size)
+{
+    if (size <= 0 || image.width % size != 0 || image.height % size != 0)
+    {
+        fprintf(stderr, "TextureAtlas: %dx%d image can't be split into %d pixel tiles\n", image.width, image.height, size);
+        return false;
+    }
+
+    tileSize = size;
+    tilesPerRow = image.width / size;
+    tileCount = tilesPerRow * (image.height / size);
+
+    // mip levels halve the tile down to 1x1, which needs a power of two size
+    levelCount = 1;
+    if ((size & (size - 1)) == 0)
+        while ((size >> (levelCount - 1)) > 1)
+            ++levelCount;
+
+    levelOffsets.resize(levelCount);
+    size_t total = 0;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        levelOffsets[level] = total;
+        total += (size_t)tileCount * LevelSize(level) * LevelSize(level);
+    }
+    texels.resize(total);
+
+    for (int tile = 0; tile < tileCount; ++tile)
+    {
+        const int originX = (tile % tilesPerRow) * size;
+        const int originY = (tile / tilesPerRow) * size;
+        for (int x = 0; x < size; ++x)
+        {
+            uint32_t *column = &texels[((size_t)tile * size + x) * size];
+            for (int y = 0; y < size; ++y)
+                column[y] = image.At(originX + x, originY + y);
+        }
+
+        for (int level = 1; level < levelCount; ++level)
+        {
+            const size_t levelTexels = (size_t)LevelSize(level) * LevelSize(level);
+            Downsample(Column(tile, 0, level - 1), LevelSize(level - 1), &texels[levelOffsets[level] + tile * levelTexels]);
+        }
+    }
+    return true;
+}
+
+bool TextureAtlas::Load(const char *path, int size)
+{
+    Image image;
+    return LoadBMP(path, image) && Build(image, size);
+}
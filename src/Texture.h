@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int texture_size = 512;      // size(width and height) of texture that will hold all wall textures
+const int texture_wall_size = 128; // size(width and height) of each wall type in the full texture
+
+// 32-bit image, row-major, top row first. Texels are packed BGRA (0xAARRGGBB)
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> texels;
+
+    uint32_t At(int x, int y) const { return texels[y * width + x]; }
+};
+
+// sprites stored in the same atlas, numbered like WallTexture (row-major tile index)
+enum class SpriteTexture
+{
+    Walker = 12,
+    Target = 13,
+};
+
+// textures decoded once at load and split into square tiles. Each tile is stored column-major, so a
+// vertical strip of a wall or sprite is one contiguous read instead of a strided walk through the image.
+// Power of two tiles also get a mip chain down to 1x1, every level stored the same way after the last
+struct TextureAtlas
+{
+    int tileSize = 0;
+    int tilesPerRow = 0;
+    int tileCount = 0;
+    int levelCount = 0;                // mip levels, 1 if tileSize isn't a power of two
+    std::vector<size_t> levelOffsets; // first texel of each level in texels
+    std::vector<uint32_t> texels;
+
+    // split an image into size x size tiles and build their mip chains
+    // returns: false if the image isn't a whole number of tiles
+    bool Build(const Image &image, int size);
+
+    // load a BMP file and split it into tiles
+    bool Load(const char *path, int size);
+
+    // edge length of a tile at a mip level
+    int LevelSize(int level) const { return tileSize >> level; }
+
+    // LevelSize(level) texels of column x of a tile at a mip level, top to bottom
+    const uint32_t *Column(int tile, int x, int level) const
+    {
+        const size_t size = (size_t)LevelSize(level);
+        return &texels[levelOffsets[level] + ((size_t)tile * size + x) * size];
+    }
+
+    // tileSize texels of column x of a tile, top to bottom
+    const uint32_t *Column(int tile, int x) const { return &texels[((size_t)tile * tileSize + x) * tileSize]; }
+    uint32_t Texel(int tile, int x, int y) const { return Column(tile, x)[y]; }
+};
+
+// load an uncompressed 24 or 32 bit BMP file
+// returns: true on success, false on errors (printed to stderr)
+bool LoadBMP(const char *path, Image &out);
+
+// save a 32 bit image as an uncompressed BMP file, rows pitch pixels apart
+bool SaveBMP(const char *path, const uint32_t *pixels, int width, int height, size_t pitch);
@@ -0,0 +1,79 @@
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    for (int i = 1; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+int ThreadPool::HardwareThreads()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return count > 0 ? (int)count : 1;
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)> &fn)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        nextJob.store(0);
+        busyWorkers = (int)workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    // the calling thread helps instead of waiting idle
+    RunJobs();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::RunJobs()
+{
+    for (int i = nextJob.fetch_add(1); i < jobCount; i = nextJob.fetch_add(1))
+        (*job)(i);
+}
+
+void ThreadPool::WorkerLoop()
+{
+    uint64_t seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+            seenGeneration = generation;
+        }
+
+        RunJobs();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0)
+            done.notify_one();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent set of worker threads for splitting per-frame work. The workers sleep between calls,
+// so there is no thread creation cost per frame.
+class ThreadPool
+{
+public:
+    // threadCount includes the calling thread, so 1 means no workers and everything runs inline
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int ThreadCount() const { return (int)workers.size() + 1; }
+
+    // run job(i) for every i in [0, count) on the workers and the calling thread.
+    // Returns once all jobs are finished.
+    void ParallelFor(int count, const std::function<void(int)> &job);
+
+    // number of hardware threads, at least 1
+    static int HardwareThreads();
+
+private:
+    void WorkerLoop();
+    void RunJobs();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)> *job = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextJob{0};
+    int busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
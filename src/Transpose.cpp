@@ -0,0 +1,239 @@
+#include "Transpose.h"
+#include <algorithm>
+
+// tile edge in pixels. 32x32 texels of source and destination stay in L1 while a tile is processed
+static const int tileSize = 32;
+
+
+static inline void TransposeScalar(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch,
+                                   int x0, int x1, int y0, int y1)
+{
+    for (int y = y0; y < y1; ++y)
+    {
+        uint32_t *row = dst + y * dstPitch;
+        for (int x = x0; x < x1; ++x)
+            row[x] = src[x * srcPitch + y];
+    }
+}
+
+#if RAYCORE_X86
+
+// transpose the 4x4 block at (x, y)
+static inline void Transpose4x4SSE2(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch, int x, int y)
+{
+    const uint32_t *s = src + x * srcPitch + y;
+    __m128i c0 = _mm_loadu_si128((const __m128i *)(s));
+    __m128i c1 = _mm_loadu_si128((const __m128i *)(s + srcPitch));
+    __m128i c2 = _mm_loadu_si128((const __m128i *)(s + 2 * srcPitch));
+    __m128i c3 = _mm_loadu_si128((const __m128i *)(s + 3 * srcPitch));
+
+    __m128i t0 = _mm_unpacklo_epi32(c0, c1);
+    __m128i t1 = _mm_unpacklo_epi32(c2, c3);
+    __m128i t2 = _mm_unpackhi_epi32(c0, c1);
+    __m128i t3 = _mm_unpackhi_epi32(c2, c3);
+
+    uint32_t *d = dst + y * dstPitch + x;
+    _mm_storeu_si128((__m128i *)(d), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(d + dstPitch), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(d + 2 * dstPitch), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i *)(d + 3 * dstPitch), _mm_unpackhi_epi64(t2, t3));
+}
+
+static void TransposeSSE2(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch,
+                          int x0, int x1, int y0, int y1)
+{
+    for (int ty = y0; ty < y1; ty += tileSize)
+    {
+        const int tyEnd = std::min(ty + tileSize, y1);
+        const int yFull = ty + ((tyEnd - ty) & ~3);
+        for (int tx = x0; tx < x1; tx += tileSize)
+        {
+            const int txEnd = std::min(tx + tileSize, x1);
+            const int xFull = tx + ((txEnd - tx) & ~3);
+            for (int y = ty; y < yFull; y += 4)
+                for (int x = tx; x < xFull; x += 4)
+                    Transpose4x4SSE2(src, srcPitch, dst, dstPitch, x, y);
+
+            TransposeScalar(src, srcPitch, dst, dstPitch, xFull, txEnd, ty, tyEnd);
+            TransposeScalar(src, srcPitch, dst, dstPitch, tx, xFull, yFull, tyEnd);
+        }
+    }
+}
+
+// transpose the 8x8 block at (x, y)
+RAYCORE_TARGET_AVX2
+static inline void Transpose8x8AVX2(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch, int x, int y)
+{
+    const uint32_t *s = src + x * srcPitch + y;
+    __m256i c0 = _mm256_loadu_si256((const __m256i *)(s));
+    __m256i c1 = _mm256_loadu_si256((const __m256i *)(s + srcPitch));
+    __m256i c2 = _mm256_loadu_si256((const __m256i *)(s + 2 * srcPitch));
+    __m256i c3 = _mm256_loadu_si256((const __m256i *)(s + 3 * srcPitch));
+    __m256i c4 = _mm256_loadu_si256((const __m256i *)(s + 4 * srcPitch));
+    __m256i c5 = _mm256_loadu_si256((const __m256i *)(s + 5 * srcPitch));
+    __m256i c6 = _mm256_loadu_si256((const __m256i *)(s + 6 * srcPitch));
+    __m256i c7 = _mm256_loadu_si256((const __m256i *)(s + 7 * srcPitch));
+
+    // interleave pairs of columns, then pairs of pairs, then swap 128-bit halves
+    __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+    __m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+    __m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+    __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+    __m256i t4 = _mm256_unpacklo_epi32(c4, c5);
+    __m256i t5 = _mm256_unpackhi_epi32(c4, c5);
+    __m256i t6 = _mm256_unpacklo_epi32(c6, c7);
+    __m256i t7 = _mm256_unpackhi_epi32(c6, c7);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    uint32_t *d = dst + y * dstPitch + x;
+    _mm256_storeu_si256((__m256i *)(d), _mm256_permute2x128_si256(u0, u4, 0x20));
+    _mm256_storeu_si256((__m256i *)(d + dstPitch), _mm256_permute2x128_si256(u1, u5, 0x20));
+    _mm256_storeu_si256((__m256i *)(d + 2 * dstPitch), _mm256_permute2x128_si256(u2, u6, 0x20));
+    _mm256_storeu_si256((__m256i *)(d + 3 * dstPitch), _mm256_permute2x128_si256(u3, u7, 0x20));
+    _mm256_storeu_si256((__m256i *)(d + 4 * dstPitch), _mm256_permute2x128_si256(u0, u4, 0x31));
+    _mm256_storeu_si256((__m256i *)(d + 5 * dstPitch), _mm256_permute2x128_si256(u1, u5, 0x31));
+    _mm256_storeu_si256((__m256i *)(d + 6 * dstPitch), _mm256_permute2x128_si256(u2, u6, 0x31));
+    _mm256_storeu_si256((__m256i *)(d + 7 * dstPitch), _mm256_permute2x128_si256(u3, u7, 0x31));
+}
+
+RAYCORE_TARGET_AVX2
+static void TransposeAVX2(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch,
+                          int x0, int x1, int y0, int y1)
+{
+    for (int ty = y0; ty < y1; ty += tileSize)
+    {
+        const int tyEnd = std::min(ty + tileSize, y1);
+        const int yFull = ty + ((tyEnd - ty) & ~7);
+        for (int tx = x0; tx < x1; tx += tileSize)
+        {
+            const int txEnd = std::min(tx + tileSize, x1);
+            const int xFull = tx + ((txEnd - tx) & ~7);
+            for (int y = ty; y < yFull; y += 8)
+                for (int x = tx; x < xFull; x += 8)
+                    Transpose8x8AVX2(src, srcPitch, dst, dstPitch, x, y);
+
+            TransposeScalar(src, srcPitch, dst, dstPitch, xFull, txEnd, ty, tyEnd);
+            TransposeScalar(src, srcPitch, dst, dstPitch, tx, xFull, yFull, tyEnd);
+        }
+    }
+}
+
+#endif
+
+void TransposeColumns(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch,
+                      int x0, int x1, int y0, int y1, SimdLevel level)
+{
+    switch (ClampSimdLevel(level))
+    {
+#if RAYCORE_X86
+    case SimdLevel::AVX2:
+        TransposeAVX2(src, srcPitch, dst, dstPitch, x0, x1, y0, y1);
+        return;
+    case SimdLevel::SSE2:
+        TransposeSSE2(src, srcPitch, dst, dstPitch, x0, x1, y0, y1);
+        return;
+#endif
+    default:
+        for (int ty = y0; ty < y1; ty += tileSize)
+            for (int tx = x0; tx < x1; tx += tileSize)
+                TransposeScalar(src, srcPitch, dst, dstPitch, tx, std::min(tx + tileSize, x1), ty, std::min(ty + tileSize, y1));
+        return;
+    }
+}
+
+static inline void ExpandScalar(const uint8_t *src, size_t srcPitch, const uint32_t *palette, uint32_t *dst, size_t dstPitch,
+                                int x0, int x1, int y0, int y1)
+{
+    for (int y = y0; y < y1; ++y)
+    {
+        uint32_t *row = dst + y * dstPitch;
+        for (int x = x0; x < x1; ++x)
+            row[x] = palette[src[x * srcPitch + y]];
+    }
+}
+
+#if RAYCORE_X86
+
+// expand the 8x8 block at (x, y)
+RAYCORE_TARGET_AVX2
+static inline void Expand8x8AVX2(const uint8_t *src, size_t srcPitch, const uint32_t *palette, uint32_t *dst, size_t dstPitch,
+                                 int x, int y)
+{
+    const uint8_t *s = src + x * srcPitch + y;
+    __m128i c0 = _mm_loadl_epi64((const __m128i *)(s));
+    __m128i c1 = _mm_loadl_epi64((const __m128i *)(s + srcPitch));
+    __m128i c2 = _mm_loadl_epi64((const __m128i *)(s + 2 * srcPitch));
+    __m128i c3 = _mm_loadl_epi64((const __m128i *)(s + 3 * srcPitch));
+    __m128i c4 = _mm_loadl_epi64((const __m128i *)(s + 4 * srcPitch));
+    __m128i c5 = _mm_loadl_epi64((const __m128i *)(s + 5 * srcPitch));
+    __m128i c6 = _mm_loadl_epi64((const __m128i *)(s + 6 * srcPitch));
+    __m128i c7 = _mm_loadl_epi64((const __m128i *)(s + 7 * srcPitch));
+
+    // interleave bytes, then pairs, then quads of columns: each 64-bit half ends up as one row
+    __m128i t0 = _mm_unpacklo_epi8(c0, c1);
+    __m128i t1 = _mm_unpacklo_epi8(c2, c3);
+    __m128i t2 = _mm_unpacklo_epi8(c4, c5);
+    __m128i t3 = _mm_unpacklo_epi8(c6, c7);
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+    const __m128i rows[4] = {_mm_unpacklo_epi32(u0, u2), _mm_unpackhi_epi32(u0, u2),
+                             _mm_unpacklo_epi32(u1, u3), _mm_unpackhi_epi32(u1, u3)};
+
+    uint32_t *d = dst + y * dstPitch + x;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m256i low = _mm256_i32gather_epi32((const int *)palette, _mm256_cvtepu8_epi32(rows[i]), 4);
+        __m256i high = _mm256_i32gather_epi32((const int *)palette, _mm256_cvtepu8_epi32(_mm_srli_si128(rows[i], 8)), 4);
+        _mm256_storeu_si256((__m256i *)(d + 2 * i * dstPitch), low);
+        _mm256_storeu_si256((__m256i *)(d + (2 * i + 1) * dstPitch), high);
+    }
+}
+
+RAYCORE_TARGET_AVX2
+static void ExpandAVX2(const uint8_t *src, size_t srcPitch, const uint32_t *palette, uint32_t *dst, size_t dstPitch,
+                       int x0, int x1, int y0, int y1)
+{
+    for (int ty = y0; ty < y1; ty += tileSize)
+    {
+        const int tyEnd = std::min(ty + tileSize, y1);
+        const int yFull = ty + ((tyEnd - ty) & ~7);
+        for (int tx = x0; tx < x1; tx += tileSize)
+        {
+            const int txEnd = std::min(tx + tileSize, x1);
+            const int xFull = tx + ((txEnd - tx) & ~7);
+            for (int y = ty; y < yFull; y += 8)
+                for (int x = tx; x < xFull; x += 8)
+                    Expand8x8AVX2(src, srcPitch, palette, dst, dstPitch, x, y);
+
+            ExpandScalar(src, srcPitch, palette, dst, dstPitch, xFull, txEnd, ty, tyEnd);
+            ExpandScalar(src, srcPitch, palette, dst, dstPitch, tx, xFull, yFull, tyEnd);
+        }
+    }
+}
+
+#endif
+
+void ExpandIndexedColumns(const uint8_t *src, size_t srcPitch, const uint32_t *palette, uint32_t *dst, size_t dstPitch,
+                          int x0, int x1, int y0, int y1, SimdLevel level)
+{
+#if RAYCORE_X86
+    if (ClampSimdLevel(level) == SimdLevel::AVX2)
+    {
+        ExpandAVX2(src, srcPitch, palette, dst, dstPitch, x0, x1, y0, y1);
+        return;
+    }
+#endif
+    for (int ty = y0; ty < y1; ty += tileSize)
+        for (int tx = x0; tx < x1; tx += tileSize)
+            ExpandScalar(src, srcPitch, palette, dst, dstPitch, tx, std::min(tx + tileSize, x1), ty, std::min(ty + tileSize, y1));
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Simd.h"
+
+// copy rows [y0, y1) of columns [x0, x1) of a column-major 32-bit image (src[x * srcPitch + y]) into a
+// row-major one (dst[y * dstPitch + x]). Works in cache-sized tiles, with 4x4 (SSE2) or 8x8 (AVX2) register transposes
+// and a scalar fallback for the edges.
+void TransposeColumns(const uint32_t *src, size_t srcPitch, uint32_t *dst, size_t dstPitch,
+                      int x0, int x1, int y0, int y1, SimdLevel level);
+
+// TransposeColumns for a column-major image of 8-bit palette indices: every index is expanded to its
+// palette colour on the way into the row-major image. The AVX2 kernel transposes 8x8 blocks of bytes and
+// looks up a row of 8 colours with one gather.
+void ExpandIndexedColumns(const uint8_t *src, size_t srcPitch, const uint32_t *palette, uint32_t *dst, size_t dstPitch,
+                          int x0, int x1, int y0, int y1, SimdLevel level);
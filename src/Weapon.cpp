@@ -0,0 +1,211 @@
+#include "Weapon.h"
+#include <algorithm>
+#include <cmath>
+#include "EnemyManager.h"
+#include "Raycaster.h"
+
+// The SIMD kernels test 4 or 8 rays against one circle at a time, operation by operation as the scalar one
+// does (same float operations in the same order, no fused multiply-adds), so all of them find the same hits.
+
+static void HitCirclesScalar(const D2D_POINT_2F &origin, const float *dirX, const float *dirY, int first, int last,
+                             const float *circleX, const float *circleY, int circles, float radius, int *hit,
+                             float *distance)
+{
+    const float radius2 = radius * radius;
+    for (int r = first; r < last; ++r)
+    {
+        float best = distance[r];
+        int bestCircle = -1;
+        for (int i = 0; i < circles; ++i)
+        {
+            const float vx = circleX[i] - origin.x;
+            const float vy = circleY[i] - origin.y;
+            const float v2 = vx * vx + vy * vy;
+            const float along = vx * dirX[r] + vy * dirY[r];
+            const float perp2 = v2 - along * along;
+            if (along > 0.0f && perp2 < radius2)
+            {
+                const float enter = along - std::sqrt(radius2 - perp2);
+                if (enter < best)
+                {
+                    best = enter;
+                    bestCircle = i;
+                }
+            }
+        }
+        hit[r] = bestCircle;
+        distance[r] = best;
+    }
+}
+
+#if RAYCORE_X86
+
+static void HitCirclesSSE2(const D2D_POINT_2F &origin, const float *dirX, const float *dirY, int rays,
+                           const float *circleX, const float *circleY, int circles, float radius, int *hit,
+                           float *distance)
+{
+    const __m128 radius2 = _mm_set1_ps(radius * radius);
+    const __m128 zero = _mm_setzero_ps();
+    for (int r = 0; r < rays; r += 4)
+    {
+        const __m128 dx = _mm_loadu_ps(dirX + r);
+        const __m128 dy = _mm_loadu_ps(dirY + r);
+        __m128 best = _mm_loadu_ps(distance + r);
+        __m128 bestCircle = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int i = 0; i < circles; ++i)
+        {
+            const float vxs = circleX[i] - origin.x;
+            const float vys = circleY[i] - origin.y;
+            const __m128 vx = _mm_set1_ps(vxs);
+            const __m128 vy = _mm_set1_ps(vys);
+            const __m128 v2 = _mm_set1_ps(vxs * vxs + vys * vys);
+            const __m128 along = _mm_add_ps(_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy));
+            const __m128 perp2 = _mm_sub_ps(v2, _mm_mul_ps(along, along));
+            // lanes that miss take the square root of a negative number, their NaN fails the comparison
+            const __m128 enter = _mm_sub_ps(along, _mm_sqrt_ps(_mm_sub_ps(radius2, perp2)));
+            const __m128 closer = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(along, zero), _mm_cmplt_ps(perp2, radius2)),
+                                             _mm_cmplt_ps(enter, best));
+            best = _mm_or_ps(_mm_and_ps(closer, enter), _mm_andnot_ps(closer, best));
+            bestCircle = _mm_or_ps(_mm_and_ps(closer, _mm_castsi128_ps(_mm_set1_epi32(i))),
+                                   _mm_andnot_ps(closer, bestCircle));
+        }
+        _mm_storeu_ps(distance + r, best);
+        _mm_storeu_si128((__m128i *)(hit + r), _mm_castps_si128(bestCircle));
+    }
+}
+
+RAYCORE_TARGET_AVX2
+static void HitCirclesAVX2(const D2D_POINT_2F &origin, const float *dirX, const float *dirY, int rays,
+                           const float *circleX, const float *circleY, int circles, float radius, int *hit,
+                           float *distance)
+{
+    const __m256 radius2 = _mm256_set1_ps(radius * radius);
+    const __m256 zero = _mm256_setzero_ps();
+    for (int r = 0; r < rays; r += 8)
+    {
+        const __m256 dx = _mm256_loadu_ps(dirX + r);
+        const __m256 dy = _mm256_loadu_ps(dirY + r);
+        __m256 best = _mm256_loadu_ps(distance + r);
+        __m256 bestCircle = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int i = 0; i < circles; ++i)
+        {
+            const float vxs = circleX[i] - origin.x;
+            const float vys = circleY[i] - origin.y;
+            const __m256 vx = _mm256_set1_ps(vxs);
+            const __m256 vy = _mm256_set1_ps(vys);
+            const __m256 v2 = _mm256_set1_ps(vxs * vxs + vys * vys);
+            const __m256 along = _mm256_add_ps(_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy));
+            const __m256 perp2 = _mm256_sub_ps(v2, _mm256_mul_ps(along, along));
+            const __m256 enter = _mm256_sub_ps(along, _mm256_sqrt_ps(_mm256_sub_ps(radius2, perp2)));
+            const __m256 closer = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(along, zero, _CMP_GT_OQ),
+                                                              _mm256_cmp_ps(perp2, radius2, _CMP_LT_OQ)),
+                                                _mm256_cmp_ps(enter, best, _CMP_LT_OQ));
+            best = _mm256_blendv_ps(best, enter, closer);
+            bestCircle = _mm256_blendv_ps(bestCircle, _mm256_castsi256_ps(_mm256_set1_epi32(i)), closer);
+        }
+        _mm256_storeu_ps(distance + r, best);
+        _mm256_storeu_si256((__m256i *)(hit + r), _mm256_castps_si256(bestCircle));
+    }
+}
+
+#endif
+
+void HitCircles(const D2D_POINT_2F &origin, const float *dirX, const float *dirY, int rays, const float *circleX,
+                const float *circleY, int circles, float radius, int *hit, float *distance, SimdLevel level)
+{
+    int r = 0;
+#if RAYCORE_X86
+    level = ClampSimdLevel(level);
+    if (level == SimdLevel::AVX2)
+    {
+        const int count = rays & ~7;
+        HitCirclesAVX2(origin, dirX, dirY, count, circleX, circleY, circles, radius, hit, distance);
+        r += count;
+    }
+    if (level >= SimdLevel::SSE2)
+    {
+        const int count = (rays - r) & ~3;
+        HitCirclesSSE2(origin, dirX + r, dirY + r, count, circleX, circleY, circles, radius, hit + r, distance + r);
+        r += count;
+    }
+#endif
+    HitCirclesScalar(origin, dirX, dirY, r, rays, circleX, circleY, circles, radius, hit, distance);
+}
+
+int Weapon::Trigger(float dt, bool held)
+{
+    cooldown -= dt;
+    if (!held)
+    {
+        // ready once the interval is over, but not storing up shots while the trigger is released
+        cooldown = std::max(cooldown, 0.0f);
+        return 0;
+    }
+    if (config.fireInterval <= 0.0f)
+    {
+        cooldown = 0.0f;
+        return 1;
+    }
+
+    int shots = 0;
+    while (cooldown <= 0.0f)
+    {
+        cooldown += config.fireInterval;
+        ++shots;
+    }
+    return shots;
+}
+
+void Weapon::Fire(const EnemyManager &enemies, const D2D_POINT_2F &origin, float angle, std::vector<PelletHit> &hits)
+{
+    // a single ray walks the grid along itself and stops at the wall, nothing to batch
+    const int pellets = std::max(1, config.pellets);
+    hits.resize(pellets);
+    if (pellets == 1)
+    {
+        const D2D_POINT_2F dir = {std::cos(angle), std::sin(angle)};
+        hits[0].enemy = enemies.Hitscan(origin, dir, hits[0].distance);
+        return;
+    }
+
+    // the pellets fan out evenly over the spread, the padding lanes point nowhere and hit nothing
+    const int padded = (pellets + 7) & ~7;
+    dirX.assign(padded, 0.0f);
+    dirY.assign(padded, 0.0f);
+    reach.assign(padded, 0.0f);
+    hit.resize(padded);
+    const Map &map = GetWorldMap();
+    for (int p = 0; p < pellets; ++p)
+    {
+        const float a = angle + config.spread * ((float)p / (pellets - 1) - 0.5f);
+        dirX[p] = std::cos(a);
+        dirY[p] = std::sin(a);
+        reach[p] = TraceWall(map, origin.x, origin.y, dirX[p], dirY[p]);
+    }
+
+    // every enemy a pellet can enter before its wall is within hitRadius of the pellet's segment up to the
+    // wall, so only the tiles of the cone the segments span are looked at, each once
+    const std::vector<D2D_POINT_2F> &positions = enemies.GetEnemies().pos;
+    ends.resize(pellets);
+    for (int p = 0; p < pellets; ++p)
+        ends[p] = {origin.x + dirX[p] * reach[p], origin.y + dirY[p] * reach[p]};
+    enemies.GetGrid().QueryFan(origin, ends, EnemyManager::hitRadius, candidates);
+
+    // one array per coordinate
+    candidateX.resize(candidates.size());
+    candidateY.resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        candidateX[i] = positions[candidates[i]].x;
+        candidateY[i] = positions[candidates[i]].y;
+    }
+
+    HitCircles(origin, dirX.data(), dirY.data(), padded, candidateX.data(), candidateY.data(), (int)candidates.size(),
+               EnemyManager::hitRadius, hit.data(), reach.data(), BestSimdLevel());
+
+    for (int p = 0; p < pellets; ++p)
+    {
+        hits[p].enemy = hit[p] >= 0 ? enemies.GetEnemies().HandleAt(candidates[hit[p]]) : EnemyHandle();
+        hits[p].distance = reach[p];
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include "Platform.h"
+#include "EnemyStore.h"
+#include "Simd.h"
+
+class EnemyManager;
+
+// how a weapon fires
+struct WeaponConfig
+{
+    int pellets = 1;            // rays per shot
+    float spread = 0.0f;        // radians between the outermost pellets
+    float fireInterval = 0.25f; // seconds from one shot to the next while the trigger is held
+};
+
+const WeaponConfig pistol = {1, 0.0f, 0.25f};
+const WeaponConfig shotgun = {32, 0.35f, 0.8f};
+
+// what one pellet of a shot hit: an enemy, or a wall if the handle is null
+struct PelletHit
+{
+    EnemyHandle enemy;
+    float distance = 0.0f;
+};
+
+// Fires at a fixed rate whatever the frame rate: pulling the trigger fires at once, holding it fires again
+// every fireInterval. Time left over from one frame carries into the next, so a long frame fires every shot
+// it covered. A shot of several pellets traces them all against the enemies along them in one batch
+class Weapon
+{
+public:
+    void SetConfig(const WeaponConfig &newConfig) { config = newConfig; }
+    const WeaponConfig &GetConfig() const { return config; }
+
+    // ready to fire
+    void Reset() { cooldown = 0.0f; }
+
+    // advance the fire schedule by dt, with the trigger held or not. Returns how many shots go off
+    int Trigger(float dt, bool held);
+
+    // one shot from origin toward angle: hits[p] is what pellet p hit. Every pellet stops at the first wall
+    void Fire(const EnemyManager &enemies, const D2D_POINT_2F &origin, float angle, std::vector<PelletHit> &hits);
+
+private:
+    WeaponConfig config = pistol;
+    float cooldown = 0.0f; // seconds until the trigger fires again
+
+    // the pellets, padded to a multiple of 8 for HitCircles, and the enemies they may hit
+    std::vector<float> dirX;
+    std::vector<float> dirY;
+    std::vector<float> reach;
+    std::vector<int> hit;
+    std::vector<D2D_POINT_2F> ends; // where each pellet meets its wall
+    std::vector<int> candidates;
+    std::vector<float> candidateX;
+    std::vector<float> candidateY;
+};
+
+// For each of rays rays from origin along (dirX[r], dirY[r]) (unit length), the first of circles circles of
+// radius around (circleX[i], circleY[i]) it enters nearer than distance[r]. hit[r] is that circle and
+// distance[r] how far it is, or -1 with distance[r] left as it was. With SSE2 or AVX2 allowed 4 or 8 rays
+// are tested against each circle at a time, so the ray arrays have to be padded to a multiple of 8; rays of
+// direction 0, 0 hit nothing. Every level finds the same hits
+void HitCircles(const D2D_POINT_2F &origin, const float *dirX, const float *dirY, int rays, const float *circleX,
+                const float *circleY, int circles, float radius, int *hit, float *distance, SimdLevel level);
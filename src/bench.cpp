@@ -0,0 +1,611 @@
+// bench.cpp - micro-benchmarks of the raycaster, pathfinding and collision hot paths, without a window
+//
+// usage: bench [--filter TEXT] [--min-time SECONDS] [--json results.json] [--textures walls.bmp] [--map level.rcmap]
+//
+// Every benchmark reports ns per operation, items per second and heap allocations per operation. Keep the
+// JSON of a run to compare against the next commit.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ClusterGraph.h"
+#include "EnemyManager.h"
+#include "MapFile.h"
+#include "Pathfinding.h"
+#include "Raycaster.h"
+#include "Sprites.h"
+#include "Weapon.h"
+#include "raycastTest.h"
+
+#ifndef ASSETS_DIR
+#define ASSETS_DIR "../../Assets"
+#endif
+
+// every heap allocation of the process goes through here, so a benchmark can count its own
+static std::atomic<uint64_t> allocationCount{0};
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// results are written here so the compiler can't drop the work
+static volatile float floatSink;
+static volatile size_t sizeSink;
+
+struct Benchmark
+{
+    std::string name;
+    double itemsPerOp; // what items/sec counts, e.g. pixels of a frame or enemies tested by a shot
+    std::function<void()> op;
+};
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;
+    double itemsPerSec = 0.0;
+    double allocsPerOp = 0.0;
+};
+
+// run op in doubling batches until minSeconds have passed, after one warm-up call
+static BenchResult Run(const Benchmark &bench, double minSeconds)
+{
+    using Clock = std::chrono::steady_clock;
+    bench.op();
+
+    BenchResult result;
+    result.name = bench.name;
+    double seconds = 0.0;
+    uint64_t allocations = 0;
+    for (uint64_t batch = 1; seconds < minSeconds; batch *= 2)
+    {
+        const uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        for (uint64_t i = 0; i < batch; ++i)
+            bench.op();
+        seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        allocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        result.iterations += batch;
+    }
+
+    result.nsPerOp = seconds * 1e9 / result.iterations;
+    result.itemsPerSec = bench.itemsPerOp * result.iterations / seconds;
+    result.allocsPerOp = (double)allocations / result.iterations;
+    return result;
+}
+
+static bool WriteJson(const char *path, const std::vector<BenchResult> &results, double minSeconds)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"simd\": \"%s\",\n  \"hardware_threads\": %d,\n  \"min_time_s\": %g,\n  \"benchmarks\": [\n",
+            SimdLevelName(BestSimdLevel()), ThreadPool::HardwareThreads(), minSeconds);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult &r = results[i];
+        fprintf(file,
+                "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"items_per_sec\": %.1f, "
+                "\"allocs_per_op\": %.3f}%s\n",
+                r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.itemsPerSec, r.allocsPerOp,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    const bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// the game's camera at a position, with its fov
+static Camera MakeCamera(float x, float y, float angle)
+{
+    Camera camera;
+    camera.x = x;
+    camera.y = y;
+    camera.angle = angle;
+    camera.planeHalf = std::tan(60.0f * (3.14159265f / 180.0f) * 0.5f);
+    return camera;
+}
+
+// a large level: walls around the edge and pillars scattered by a fixed seed, with its cluster graph
+struct OpenLevel
+{
+    std::vector<char> tiles;
+    Map map;
+    ClusterGraph graph;
+};
+
+// a side x side level walled around its edge, with about pillarsPer256 / 256 of the rest scattered pillars
+static std::shared_ptr<OpenLevel> MakeOpenLevel(int side, uint32_t pillarsPer256)
+{
+    auto level = std::make_shared<OpenLevel>();
+    level->tiles.assign((size_t)side * side, '.');
+    uint32_t seed = 12345;
+    for (int y = 0; y < side; ++y)
+        for (int x = 0; x < side; ++x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const bool edge = x == 0 || y == 0 || x == side - 1 || y == side - 1;
+            if (edge || (seed >> 24) < pillarsPer256)
+                level->tiles[(size_t)y * side + x] = '#';
+        }
+    // keep the corners the paths run between open
+    level->tiles[(size_t)1 * side + 1] = '.';
+    level->tiles[(size_t)(side - 2) * side + side - 2] = '.';
+
+    level->map = GetBuiltinMap();
+    level->map.width = side;
+    level->map.height = side;
+    level->map.tiles = level->tiles.data();
+    return level;
+}
+
+static void AddPathBenchmarks(std::vector<Benchmark> &benches)
+{
+    struct PathCase
+    {
+        const char *name;
+        std::shared_ptr<OpenLevel> level; // null for the current map
+        IPoint start;
+        IPoint goal;
+    };
+    // the map is one connected region, so the unreachable case is a goal inside a wall
+    // open has about one tile in ten a pillar, sparse one in a hundred, empty none: the corner to corner
+    // path has many equally short ways there, which JPS searches one of
+    const int openSide = 1024;
+    const auto open = MakeOpenLevel(openSide, 26);
+    const auto sparse = MakeOpenLevel(openSide, 3);
+    const auto empty = MakeOpenLevel(openSide, 0);
+    const PathCase cases[] = {
+        {"short", nullptr, {12, 12}, {14, 13}},
+        {"long", nullptr, {1, 1}, {22, 22}},
+        {"unreachable", nullptr, {1, 1}, {15, 1}},
+        {"open 1024", open, {1, 1}, {openSide - 2, openSide - 2}},
+        {"sparse 1024", sparse, {1, 1}, {openSide - 2, openSide - 2}},
+        {"empty 1024", empty, {1, 1}, {openSide - 2, openSide - 2}},
+    };
+
+    // AStarTilePath allocates its arrays for every search; PathSearch keeps them, with or without jump points.
+    // ClusterGraph routes over clusters of 16x16 tiles, built once per map
+    auto search = std::make_shared<PathSearch>();
+    auto path = std::make_shared<std::vector<IPoint>>();
+    auto route = std::make_shared<ClusterRoute>();
+    auto currentGraph = std::make_shared<ClusterGraph>();
+    for (ClusterGraph *graph : {currentGraph.get(), &open->graph, &sparse->graph, &empty->graph})
+    {
+        const Map &map = graph == currentGraph.get() ? GetWorldMap()
+                         : graph == &open->graph    ? open->map
+                         : graph == &sparse->graph  ? sparse->map
+                                                    : empty->map;
+        const auto start = std::chrono::steady_clock::now();
+        graph->Build(map);
+        printf("  ClusterGraph of %dx%d tiles: %d clusters, %d nodes, built in %.3f ms\n", map.width, map.height,
+               graph->ClusterCount(), graph->NodeCount(),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    for (const PathCase &c : cases)
+    {
+        const Map *current = &GetWorldMap();
+        const Map *map = c.level ? &c.level->map : current;
+        // aliasing the level's graph keeps the level alive with it
+        const auto graph = c.level ? std::shared_ptr<ClusterGraph>(c.level, &c.level->graph) : currentGraph;
+
+        SetWorldMap(*map);
+        const size_t length = AStarTilePath(c.start, c.goal).size();
+        SetWorldMap(*current);
+        search->AStar(*map, c.start, c.goal, *path);
+        const int aStarExpanded = search->Expanded();
+        search->JumpPoint(*map, c.start, c.goal, *path);
+        const int jumpExpanded = search->Expanded();
+        const size_t jumpLength = path->size();
+        size_t routeLength = graph->FindRoute(c.start, c.goal, *route) ? 1 : 0;
+        const int routeExpanded = graph->Expanded();
+        while (graph->NextSegment(*route, *path))
+            routeLength += path->size() - 1;
+        printf("  %-36s %zu tiles, %d nodes expanded by A*, %d by JPS (%zu tiles), %d by HPA* (%zu tiles)\n", c.name,
+               length, aStarExpanded, jumpExpanded, jumpLength, routeExpanded, routeLength);
+
+        const std::string suffix = std::string("/") + c.name;
+        benches.push_back({"AStarTilePath" + suffix, 1.0, [c, map, current]() {
+                               SetWorldMap(*map);
+                               sizeSink = AStarTilePath(c.start, c.goal).size();
+                               SetWorldMap(*current);
+                           }});
+        benches.push_back({"PathSearch::AStar" + suffix, 1.0, [c, map, search, path]() {
+                               search->AStar(*map, c.start, c.goal, *path);
+                               sizeSink = path->size();
+                           }});
+        benches.push_back({"PathSearch::JumpPoint" + suffix, 1.0, [c, map, search, path]() {
+                               search->JumpPoint(*map, c.start, c.goal, *path);
+                               sizeSink = path->size();
+                           }});
+        benches.push_back({"ClusterGraph::FindRoute" + suffix, 1.0, [c, graph, route]() {
+                               graph->FindRoute(c.start, c.goal, *route);
+                               sizeSink = route->waypoints.size();
+                           }});
+        // what a walker pays for the whole way: the route plus every cluster's tile path
+        benches.push_back({"ClusterGraph+segments" + suffix, 1.0, [c, graph, route, path]() {
+                               size_t tiles = 0;
+                               graph->FindRoute(c.start, c.goal, *route);
+                               while (graph->NextSegment(*route, *path))
+                                   tiles += path->size();
+                               sizeSink = tiles;
+                           }});
+    }
+
+    // a pillar of the open level appearing and disappearing, rebuilding the clusters around it each time
+    auto toggle = std::make_shared<int>(0);
+    benches.push_back({"ClusterGraph::TileChanged", 1.0, [open, toggle]() {
+                           const int x = 500 + (*toggle & 15), y = 500;
+                           char &tile = open->tiles[(size_t)y * open->map.width + x];
+                           tile = (++*toggle & 16) ? '#' : '.';
+                           open->graph.TileChanged(x, y);
+                       }});
+}
+
+static void AddEnemyBenchmarks(std::vector<Benchmark> &benches)
+{
+    // every floor tile, to spread the walkers over
+    const Map &map = GetWorldMap();
+    std::vector<IPoint> floor;
+    for (int y = 0; y < map.height && floor.size() < 100000; ++y)
+        for (int x = 0; x < map.width && floor.size() < 100000; ++x)
+            if (map.Walkable(x, y))
+                floor.push_back({x, y});
+
+    struct EnemyCase
+    {
+        PathMode mode;
+        const char *name;
+        int walkers;
+        int budget; // path search nodes per frame, 0 searches every request in the frame it's made
+    };
+    const int budget = PathScheduler::defaultBudget;
+    const EnemyCase cases[] = {
+        {PathMode::AStar, "A*", 100, budget},
+        {PathMode::AStar, "A*", 1000, budget},
+        {PathMode::AStar, "A* sync", 1000, 0},
+        {PathMode::FlowField, "flow", 100, budget},
+        {PathMode::FlowField, "flow", 1000, budget},
+        {PathMode::FlowField, "flow", 10000, budget},
+        {PathMode::FlowField, "flow", 100000, budget},
+        {PathMode::Hierarchical, "HPA*", 100, budget},
+        {PathMode::Hierarchical, "HPA*", 1000, budget},
+        {PathMode::Hierarchical, "HPA* sync", 1000, 0},
+    };
+    for (const EnemyCase &c : cases)
+    {
+        // one frame of walkers chasing a player who runs back and forth along a corridor of the built-in
+        // map, changing tiles every few frames. Attacks are off so the run doesn't log
+        auto manager = std::make_shared<EnemyManager>();
+        manager->SetPathMode(c.mode);
+        manager->SetPathBudget(c.budget);
+        manager->SetSpawningEnabled(false);
+        EnemyConfig config;
+        config.attackRange = 0.0f;
+        for (int i = 0; i < c.walkers; ++i)
+        {
+            const IPoint tile = floor[(size_t)i * 7919 % floor.size()];
+            manager->AddEnemy(TileCenter(tile), EnemyType::Walker, config);
+        }
+
+        auto frame = std::make_shared<int>(0);
+        auto step = [manager, frame]() {
+            const float t = (++*frame % 360) / 180.0f;
+            const float x = 2.5f + 18.0f * (t < 1.0f ? t : 2.0f - t);
+            manager->Update(1.0f / 60.0f, {x, 11.5f});
+        };
+        const std::string name = "EnemyManager::Update/" + std::to_string(c.walkers) + " " + c.name;
+
+        // the average hides the frames where every walker repaths at once, so report the worst of one run
+        // back and forth, after a first one to warm up
+        if (c.mode != PathMode::FlowField)
+        {
+            double worst = 0.0;
+            int waiting = 0;
+            for (int i = 0; i < 360; ++i)
+                step();
+            for (int i = 0; i < 360; ++i)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                step();
+                worst = std::max(worst, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                waiting = std::max(waiting, manager->GetPathScheduler().Pending());
+            }
+            printf("  %-36s worst frame %.3f ms, up to %d path requests waiting\n", name.c_str(), worst, waiting);
+        }
+        benches.push_back({name, (double)c.walkers, step});
+    }
+
+    // enemies dying and spawning among 100k: remove one by its handle, add another in its stead
+    auto store = std::make_shared<EnemyStore>();
+    auto handles = std::make_shared<std::vector<EnemyHandle>>();
+    const int storeSize = 100000;
+    store->Reserve(storeSize);
+    for (int i = 0; i < storeSize; ++i)
+        handles->push_back(store->Add(TileCenter(floor[(size_t)i % floor.size()]), EnemyType::Walker));
+    auto churn = std::make_shared<int>(0);
+    benches.push_back({"EnemyStore remove+add/100000 enemies", 1000.0, [store, handles, churn]() {
+                           for (int i = 0; i < 1000; ++i)
+                           {
+                               EnemyHandle &handle = (*handles)[(size_t)(++*churn) * 7919 % handles->size()];
+                               const D2D_POINT_2F p = store->pos[store->IndexOf(handle)];
+                               store->Remove(handle);
+                               handle = store->Add(p, EnemyType::Walker);
+                           }
+                           sizeSink = store->Size();
+                       }});
+}
+
+static void AddCollisionBenchmarks(std::vector<Benchmark> &benches)
+{
+    // player sized boxes spread over the whole map, walls and floor alike
+    const int queries = 1024;
+    std::vector<D2D_POINT_2F> positions(queries);
+    for (int i = 0; i < queries; ++i)
+        positions[i] = D2D1::Point2F(0.5f + (i * 7919 % 2300) / 100.0f, 0.5f + (i * 104729 % 2300) / 100.0f);
+
+    benches.push_back({"canMove/1024 positions", (double)queries, [positions]() {
+                           const D2D_POINT_2F size = {0.35f, 0.35f};
+                           size_t free = 0;
+                           for (const D2D_POINT_2F &p : positions)
+                               free += canMove(p, size);
+                           sizeSink = free;
+                       }});
+}
+
+static void AddHitscanBenchmarks(std::vector<Benchmark> &benches)
+{
+    for (int count : {10, 100, 10000})
+    {
+        // enemies scattered over the floor, shot at from the start position in a different direction each time
+        auto manager = std::make_shared<EnemyManager>();
+        for (int i = 0; i < count; ++i)
+            manager->AddEnemy(D2D1::Point2F(1.5f + (i * 7919 % 2100) / 100.0f, 1.5f + (i * 104729 % 2100) / 100.0f),
+                              EnemyType::Walker);
+
+        auto shot = std::make_shared<int>(0);
+        benches.push_back({"Hitscan/" + std::to_string(count) + " enemies", (double)count, [manager, shot]() {
+                               const float angle = 0.01f * (++*shot % 628);
+                               const D2D_POINT_2F pos = {12.0f, 12.0f};
+                               const D2D_POINT_2F dir = {std::cos(angle), std::sin(angle)};
+                               float distance;
+                               sizeSink = manager->Hitscan(pos, dir, distance).generation;
+                               floatSink = distance;
+                           }});
+
+        // the spatial grid's own queries, around a point moving over the map
+        auto nearby = std::make_shared<std::vector<int>>();
+        benches.push_back({"EnemyGrid radius 1.5/" + std::to_string(count) + " enemies", (double)count,
+                           [manager, shot, nearby]() {
+                               const D2D_POINT_2F center = {1.5f + (++*shot * 7 % 21), 1.5f + (*shot * 13 % 21)};
+                               manager->GetGrid().QueryRadius(manager->GetEnemies().pos, center, 1.5f, *nearby);
+                               sizeSink = nearby->size();
+                           }});
+        benches.push_back({"EnemyGrid nearest/" + std::to_string(count) + " enemies", (double)count, [manager, shot]() {
+                               const D2D_POINT_2F center = {1.5f + (++*shot * 7 % 21), 1.5f + (*shot * 13 % 21)};
+                               sizeSink = manager->GetGrid().Nearest(manager->GetEnemies().pos, center, 1e30f);
+                           }});
+    }
+}
+
+static void AddWeaponBenchmarks(std::vector<Benchmark> &benches)
+{
+    // the pellet kernel alone: 64 pellets fanned over 0.35 radians against 1000 circles ahead of them
+    auto pellets = std::make_shared<std::vector<float>>(128);
+    auto circles = std::make_shared<std::vector<float>>(2000);
+    for (int p = 0; p < 64; ++p)
+    {
+        const float a = 0.35f * ((float)p / 63 - 0.5f);
+        (*pellets)[p] = std::cos(a);
+        (*pellets)[64 + p] = std::sin(a);
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        (*circles)[i] = 1.0f + (i * 7919 % 3000) / 100.0f;
+        (*circles)[1000 + i] = -5.0f + (i * 104729 % 1000) / 100.0f;
+    }
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+    {
+        if (ClampSimdLevel(level) != level)
+            continue;
+        auto hit = std::make_shared<std::vector<int>>(64);
+        auto distance = std::make_shared<std::vector<float>>(64);
+        benches.push_back({std::string("HitCircles 64x1000/") + SimdLevelName(level), 64.0 * 1000,
+                           [pellets, circles, hit, distance, level]() {
+                               std::fill(distance->begin(), distance->end(), 1e30f);
+                               HitCircles({0.0f, 0.0f}, pellets->data(), pellets->data() + 64, 64, circles->data(),
+                                          circles->data() + 1000, 1000, 0.5f, hit->data(), distance->data(), level);
+                               sizeSink = (*hit)[0];
+                           }});
+    }
+
+    // a whole shotgun shot with 64 pellets from the start position, into 1000 enemies scattered over the floor
+    auto manager = std::make_shared<EnemyManager>();
+    for (int i = 0; i < 1000; ++i)
+        manager->AddEnemy(D2D1::Point2F(1.5f + (i * 7919 % 2100) / 100.0f, 1.5f + (i * 104729 % 2100) / 100.0f),
+                          EnemyType::Walker);
+    auto weapon = std::make_shared<Weapon>();
+    WeaponConfig config = shotgun;
+    config.pellets = 64;
+    weapon->SetConfig(config);
+    auto hits = std::make_shared<std::vector<PelletHit>>();
+    auto shot = std::make_shared<int>(0);
+    benches.push_back({"Weapon::Fire 64 pellets/1000 enemies", 64.0, [manager, weapon, hits, shot]() {
+                           const Map &map = GetWorldMap();
+                           weapon->Fire(*manager, {map.startX, map.startY}, 0.01f * (++*shot % 628), *hits);
+                           floatSink = (*hits)[0].distance;
+                       }});
+}
+
+static void AddFrameBenchmarks(std::vector<Benchmark> &benches, const TextureAtlas &atlas)
+{
+    struct Size
+    {
+        const char *name;
+        int width, height;
+    };
+    for (const Size &size : {Size{"720p", 1280, 720}, Size{"1080p", 1920, 1080}, Size{"4K", 3840, 2160}})
+    {
+        // a full serial wall frame, turning a little every frame so the wall spans change
+        auto fb = std::make_shared<Framebuffer>();
+        fb->Resize(size.width, size.height);
+        auto frame = std::make_shared<int>(0);
+        benches.push_back({std::string("RenderFrame/") + size.name, (double)size.width * size.height,
+                           [&atlas, fb, frame]() {
+                               const Map &map = GetWorldMap();
+                               const Camera camera = MakeCamera(map.startX, map.startY, 0.01f * (++*frame % 628));
+                               RenderFrame(camera, GetWorldMap(), atlas, *fb, RenderOptions());
+                           }});
+    }
+}
+
+static void AddSpriteBenchmarks(std::vector<Benchmark> &benches, const TextureAtlas &atlas, const SpriteRuns &runs)
+{
+    // 20 enemies in front of the camera, 1.5 to 4 tiles away, over one 1080p wall frame
+    const Map &map = GetWorldMap();
+    std::vector<Sprite> close;
+    for (int i = 0; i < 20; ++i)
+    {
+        Sprite sprite;
+        const float angle = -0.45f + 0.9f * i / 19;
+        const float distance = 1.5f + 2.5f * ((i * 7) % 20) / 19;
+        sprite.x = map.startX + distance * std::cos(angle);
+        sprite.y = map.startY + distance * std::sin(angle);
+        sprite.texture = i % 2 ? SpriteTexture::Target : SpriteTexture::Walker;
+        close.push_back(sprite);
+    }
+
+    // a pickup on every quarter of every floor tile within 12 tiles of the start (the whole built-in map),
+    // mostly hidden behind walls
+    std::vector<Sprite> everywhere;
+    const int x0 = std::max(0, (int)map.startX - 12), x1 = std::min(map.width, (int)map.startX + 12);
+    const int y0 = std::max(0, (int)map.startY - 12), y1 = std::min(map.height, (int)map.startY + 12);
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+            for (int i = 0; i < 4 && map.Walkable(x, y); ++i)
+            {
+                Sprite sprite;
+                sprite.x = x + 0.25f + 0.5f * (i & 1);
+                sprite.y = y + 0.25f + 0.5f * (i >> 1);
+                everywhere.push_back(sprite);
+            }
+
+    const Camera camera = MakeCamera(map.startX, map.startY, 0.0f);
+    auto fb = std::make_shared<Framebuffer>();
+    fb->Resize(1920, 1080);
+    RenderFrame(camera, map, atlas, *fb, RenderOptions());
+
+    struct Scene
+    {
+        std::string name;
+        std::vector<Sprite> sprites;
+    };
+    for (const Scene &scene : {Scene{"DrawSprites/20 up close", close},
+                               Scene{"DrawSprites/" + std::to_string(everywhere.size()) + " pickups", everywhere}})
+    {
+        auto sprites = std::make_shared<std::vector<Sprite>>(scene.sprites);
+        benches.push_back({scene.name, (double)sprites->size(), [&atlas, &runs, fb, sprites, camera]() {
+                               sizeSink = DrawSprites(camera, *sprites, atlas, runs, *fb);
+                           }});
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = nullptr;
+    const char *jsonPath = nullptr;
+    double minSeconds = 0.5;
+    std::string texturePath = ASSETS_DIR "/walls.bmp";
+    const char *mapPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--filter") && hasValue)
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "--json") && hasValue)
+            jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--min-time") && hasValue)
+            minSeconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--textures") && hasValue)
+            texturePath = argv[++i];
+        else if (!strcmp(argv[i], "--map") && hasValue)
+            mapPath = argv[++i];
+        else
+        {
+            fprintf(stderr,
+                    "usage: %s [--filter TEXT] [--min-time SECONDS] [--json results.json] [--textures walls.bmp] "
+                    "[--map level.rcmap]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    MapFile mapFile;
+    if (mapPath)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if (!mapFile.Open(mapPath))
+            return 1;
+        SetWorldMap(mapFile.GetMap());
+        printf("%s: %dx%d tiles, opened in %.3f ms\n", mapPath, mapFile.GetMap().width, mapFile.GetMap().height,
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    TextureAtlas atlas;
+    if (!atlas.Load(texturePath.c_str(), texture_wall_size))
+        return 1;
+    SpriteRuns spriteRuns;
+    spriteRuns.Build(atlas);
+
+    std::vector<Benchmark> benches;
+    AddPathBenchmarks(benches);
+    AddEnemyBenchmarks(benches);
+    AddCollisionBenchmarks(benches);
+    AddHitscanBenchmarks(benches);
+    AddWeaponBenchmarks(benches);
+    AddFrameBenchmarks(benches, atlas);
+    AddSpriteBenchmarks(benches, atlas, spriteRuns);
+
+    std::vector<BenchResult> results;
+    for (const Benchmark &bench : benches)
+    {
+        if (filter && bench.name.find(filter) == std::string::npos)
+            continue;
+        results.push_back(Run(bench, minSeconds));
+        const BenchResult &r = results.back();
+        printf("%-36s %14.1f ns/op %16.0f items/s %8.2f allocs/op\n", r.name.c_str(), r.nsPerOp, r.itemsPerSec,
+               r.allocsPerOp);
+    }
+
+    if (jsonPath && !WriteJson(jsonPath, results, minSeconds))
+        return 1;
+    return 0;
+}
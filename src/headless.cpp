@@ -0,0 +1,677 @@
+// headless.cpp - renders frames to memory without a window, for profiling the raycaster on any platform
+//
+// usage: Headless [--size WxH] [--frames N] [--threads N] [--textures walls.bmp] [--out frame.bmp]
+//                 [--textured-floor] [--indexed] [--fog D] [--sprites] [--bench-layout] [--bench-threads] [--bench-rays] [--bench-mips]
+//                 [--bench-floor] [--bench-sprites] [--trace trace.json|trace.csv] [--trace-frames N]
+//                 [--replay session.log] [--replay-csv frames.csv] [--map level.rcmap]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "InputLog.h"
+#include "MapFile.h"
+#include "Profiler.h"
+#include "Raycaster.h"
+#include "Simulation.h"
+#include "Sprites.h"
+
+#ifndef ASSETS_DIR
+#define ASSETS_DIR "../../Assets"
+#endif
+
+struct RunResult
+{
+    double avgMs = 0.0;
+    double minMs = 1e30;
+    double maxMs = 0.0;
+    RenderStats stages;   // summed over all frames
+    double dirtyRows = 0.0; // average rows changed per frame, i.e. what a presenter would upload
+    double spriteMs = 0.0;  // summed over all frames
+    double spritesDrawn = 0.0; // average sprites left after culling per frame
+    uint64_t hash = 0;    // FNV-1a over every rendered frame, to check that modes agree
+};
+
+static uint64_t HashPixels(uint64_t hash, const Framebuffer &fb)
+{
+    for (int y = 0; y < fb.height; ++y)
+    {
+        const uint32_t *row = fb.Pixels() + y * fb.pitch;
+        for (int x = 0; x < fb.width; ++x)
+        {
+            hash ^= row[x];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// render frames turning a full circle at the game's start position and fov, with sprites composited on top
+static RunResult RunFrames(const TextureAtlas &atlas, Framebuffer &fb, int frames, RenderOptions options, bool hash,
+                           const std::vector<Sprite> &sprites = std::vector<Sprite>(),
+                           const SpriteRuns *spriteRuns = nullptr)
+{
+    Camera camera;
+    camera.x = GetWorldMap().startX;
+    camera.y = GetWorldMap().startY;
+    const float fov = 60.0f * (3.14159265f / 180.0f);
+    camera.planeHalf = std::tan(fov * 0.5f);
+
+    RenderStats stats;
+    options.stats = &stats;
+
+    using Clock = std::chrono::steady_clock;
+    RunResult result;
+    result.hash = 14695981039346656037ull;
+    double totalMs = 0.0;
+
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        camera.angle = 2.0f * 3.14159265f * frame / frames;
+
+        PROFILE_FRAME();
+        PROFILE_ZONE("Frame");
+        auto start = Clock::now();
+        RenderFrame(camera, GetWorldMap(), atlas, fb, options);
+        auto spritesStart = Clock::now();
+        if (spriteRuns)
+            result.spritesDrawn += DrawSprites(camera, sprites, atlas, *spriteRuns, fb);
+        auto end = Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        result.spriteMs += std::chrono::duration<double, std::milli>(end - spritesStart).count();
+
+        totalMs += ms;
+        if (ms < result.minMs)
+            result.minMs = ms;
+        if (ms > result.maxMs)
+            result.maxMs = ms;
+        result.stages.wallMs += stats.wallMs;
+        result.stages.transposeMs += stats.transposeMs;
+        result.stages.floorMs += stats.floorMs;
+        result.stages.texelFetches += stats.texelFetches;
+        result.stages.texelLines += stats.texelLines;
+
+        if (hash)
+            result.hash = HashPixels(result.hash, fb);
+
+        result.dirtyRows += fb.dirtyBottom - fb.dirtyTop;
+        fb.ClearDirtyRows();
+    }
+
+    if (frames > 0)
+    {
+        result.avgMs = totalMs / frames;
+        result.dirtyRows /= frames;
+        result.spritesDrawn /= frames;
+    }
+    return result;
+}
+
+// a few billboards around the start position, for checking the compositing without a game
+static std::vector<Sprite> TestSprites()
+{
+    const float positions[][2] = {{8.5f, 12.5f}, {14.5f, 11.5f}, {5.5f, 9.5f}, {10.5f, 3.5f}, {18.5f, 11.5f}, {3.5f, 13.5f}};
+    std::vector<Sprite> sprites;
+    for (const auto &p : positions)
+    {
+        const Map &map = GetWorldMap();
+        if ((int)p[0] >= map.width || (int)p[1] >= map.height || !map.Walkable((int)p[0], (int)p[1]))
+            continue;
+        Sprite sprite;
+        sprite.x = p[0];
+        sprite.y = p[1];
+        sprite.texture = sprites.size() % 2 ? SpriteTexture::Target : SpriteTexture::Walker;
+        sprites.push_back(sprite);
+    }
+    return sprites;
+}
+
+// enemies crowding the player, the worst case for sprite fill: count billboards on a ring around the start position
+static std::vector<Sprite> CloseSprites(int count, float radius)
+{
+    std::vector<Sprite> sprites;
+    for (int i = 0; i < count; ++i)
+    {
+        const float angle = 2.0f * 3.14159265f * i / count;
+        Sprite sprite;
+        sprite.x = GetWorldMap().startX + radius * std::cos(angle);
+        sprite.y = GetWorldMap().startY + radius * std::sin(angle);
+        sprite.texture = i % 2 ? SpriteTexture::Target : SpriteTexture::Walker;
+        sprites.push_back(sprite);
+    }
+    return sprites;
+}
+
+// a pickup on every quarter of every floor tile within 12 tiles of the start (the whole built-in map), most
+// of them hidden behind walls from any view
+static std::vector<Sprite> SpritesEverywhere()
+{
+    const Map &map = GetWorldMap();
+    const int x0 = std::max(0, (int)map.startX - 12), x1 = std::min(map.width, (int)map.startX + 12);
+    const int y0 = std::max(0, (int)map.startY - 12), y1 = std::min(map.height, (int)map.startY + 12);
+    std::vector<Sprite> sprites;
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+        {
+            if (!map.Walkable(x, y))
+                continue;
+            for (int i = 0; i < 4; ++i)
+            {
+                Sprite sprite;
+                sprite.x = x + 0.25f + 0.5f * (i & 1);
+                sprite.y = y + 0.25f + 0.5f * (i >> 1);
+                sprite.texture = i % 2 ? SpriteTexture::Target : SpriteTexture::Walker;
+                sprites.push_back(sprite);
+            }
+        }
+    return sprites;
+}
+
+// time sprite compositing against the walls behind it, for a few sprites far away, a crowd up close and
+// thousands all over the map
+static void BenchSprites(const TextureAtlas &atlas, const SpriteRuns &spriteRuns, Framebuffer &fb, int frames)
+{
+    printf("%dx%d, %d frames per scene, %zu opaque runs in %zu sprite columns\n", fb.width, fb.height, frames,
+           spriteRuns.runs.size(), spriteRuns.columnStart.size() - 1);
+
+    struct Scene
+    {
+        const char *name;
+        std::vector<Sprite> sprites;
+    };
+    const Scene scenes[] = {
+        {"scattered", TestSprites()},
+        {"20 up close", CloseSprites(20, 1.5f)},
+        {"everywhere", SpritesEverywhere()},
+    };
+    for (const Scene &scene : scenes)
+    {
+        RunResult run = RunFrames(atlas, fb, frames, RenderOptions(), false, scene.sprites, &spriteRuns);
+        printf("  %-12s avg %7.3f ms/frame (walls %7.3f, sprites %7.3f), %5.0f of %zu sprites drawn\n", scene.name,
+               run.avgMs, run.stages.wallMs / frames, run.spriteMs / frames, run.spritesDrawn, scene.sprites.size());
+    }
+}
+
+// compare the row-major wall writer against column-major rendering with each set of SIMD kernels
+// (ray packets and transpose), and against the 8-bit palette pipeline
+static bool BenchLayouts(const TextureAtlas &atlas, const IndexedTextures &indexed, Framebuffer &fb, int frames)
+{
+    struct Mode
+    {
+        const char *name;
+        FramebufferLayout layout;
+        SimdLevel simd;
+    };
+    const Mode modes[] = {
+        {"row-major", FramebufferLayout::RowMajor, SimdLevel::Scalar},
+        {"column-major + scalar kernels", FramebufferLayout::ColumnMajor, SimdLevel::Scalar},
+        {"column-major + SSE2 kernels", FramebufferLayout::ColumnMajor, SimdLevel::SSE2},
+        {"column-major + AVX2 kernels", FramebufferLayout::ColumnMajor, SimdLevel::AVX2},
+        {"indexed + scalar kernels", FramebufferLayout::IndexedColumns, SimdLevel::Scalar},
+        {"indexed + AVX2 kernels", FramebufferLayout::IndexedColumns, SimdLevel::AVX2},
+    };
+
+    printf("%dx%d, %d frames per layout\n", fb.width, fb.height, frames);
+
+    bool identical = true;
+    uint64_t referenceHash = 0;
+    uint64_t indexedHash = 0;
+    for (const Mode &mode : modes)
+    {
+        if (ClampSimdLevel(mode.simd) != mode.simd)
+        {
+            printf("  %-34s not supported on this CPU\n", mode.name);
+            continue;
+        }
+
+        RenderOptions options;
+        options.layout = mode.layout;
+        options.simd = mode.simd;
+        options.indexed = &indexed;
+
+        // one untimed pass to check the output, then the timed pass
+        RunResult check = RunFrames(atlas, fb, frames, options, true);
+        RunResult run = RunFrames(atlas, fb, frames, options, false);
+
+        // the palette changes the colours, so indexed modes are only compared with each other
+        const bool isIndexed = mode.layout == FramebufferLayout::IndexedColumns;
+        uint64_t &reference = isIndexed ? indexedHash : referenceHash;
+        if (mode.layout == FramebufferLayout::RowMajor || (isIndexed && mode.simd == SimdLevel::Scalar))
+            reference = check.hash;
+        const bool same = check.hash == reference;
+        identical = identical && same;
+
+        printf("  %-34s avg %7.3f ms/frame (walls %7.3f, transpose %6.3f)%s\n", mode.name, run.avgMs,
+               run.stages.wallMs / frames, run.stages.transposeMs / frames, same ? "" : "  OUTPUT DIFFERS");
+    }
+    return identical;
+}
+
+// trace every column of many camera poses with the scalar DDA and the 4 and 8 wide ray packets, check that
+// all hits match exactly and compare the time per frame of rays
+static bool BenchRays(int width, int frames)
+{
+    const Map &map = GetWorldMap();
+    std::vector<RayHit> hits(width);
+    std::vector<RayHit> reference(width);
+
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    double totalMs[3] = {0.0, 0.0, 0.0};
+    bool identical = true;
+
+    using Clock = std::chrono::steady_clock;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        // walk around the open area while turning, so rays start from many different tiles and offsets
+        Camera camera;
+        camera.x = 3.3f + 10.0f * frame / frames;
+        camera.y = 2.7f + 9.0f * ((frame * 7) % frames) / frames;
+        camera.angle = 2.0f * 3.14159265f * frame / frames * 3.0f;
+        camera.planeHalf = std::tan(30.0f * (3.14159265f / 180.0f));
+        if ((int)camera.x >= map.width || (int)camera.y >= map.height || !map.Walkable((int)camera.x, (int)camera.y))
+            continue;
+        const RayBasis basis(camera);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            if (ClampSimdLevel(levels[i]) != levels[i])
+                continue;
+
+            std::vector<RayHit> &out = i == 0 ? reference : hits;
+            auto start = Clock::now();
+            CastRays(basis, map, 0, width, width, out.data(), levels[i]);
+            totalMs[i] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            if (i == 0)
+                continue;
+            for (int x = 0; x < width; ++x)
+            {
+                const RayHit &a = reference[x];
+                const RayHit &b = hits[x];
+                if (a.perpWallDist != b.perpWallDist || a.dirX != b.dirX || a.dirY != b.dirY ||
+                    a.wallX != b.wallX || a.side != b.side || a.tile != b.tile)
+                {
+                    if (identical)
+                        fprintf(stderr, "%s ray %d of frame %d differs from the scalar DDA\n", SimdLevelName(levels[i]), x, frame);
+                    identical = false;
+                }
+            }
+        }
+    }
+
+    printf("%d rays per frame, %d frames\n", width, frames);
+    for (int i = 0; i < 3; ++i)
+    {
+        if (ClampSimdLevel(levels[i]) != levels[i])
+            printf("  %-7s not supported on this CPU\n", SimdLevelName(levels[i]));
+        else
+            printf("  %-7s avg %7.3f ms/frame\n", SimdLevelName(levels[i]), totalMs[i] / frames);
+    }
+    printf("  packet hits %s the scalar DDA\n", identical ? "match" : "DO NOT match");
+    return identical;
+}
+
+// compare sampling the walls from the full size textures against the mip chain, with the number of
+// texels read and the texture cache lines they touch
+static void BenchMips(const TextureAtlas &atlas, Framebuffer &fb, int frames)
+{
+    printf("%dx%d, %d frames, %d mip levels\n", fb.width, fb.height, frames, atlas.levelCount);
+
+    for (int mipmaps = 0; mipmaps < 2; ++mipmaps)
+    {
+        RenderOptions options;
+        options.mipmaps = mipmaps != 0;
+        RunResult run = RunFrames(atlas, fb, frames, options, false);
+
+        printf("  %-10s avg %7.3f ms/frame (walls %7.3f), %9.0f texel fetches, %8.0f cache lines per frame\n",
+               mipmaps ? "mipmaps" : "level 0", run.avgMs, run.stages.wallMs / frames,
+               (double)run.stages.texelFetches / frames, (double)run.stages.texelLines / frames);
+    }
+}
+
+// time flat against textured floors and ceilings, serial, with each set of SIMD kernels for the floor,
+// and check that the kernels draw the same floor
+static bool BenchFloor(const TextureAtlas &atlas, Framebuffer &fb, int frames)
+{
+    printf("%dx%d, %d frames per mode\n", fb.width, fb.height, frames);
+
+    RunResult flat = RunFrames(atlas, fb, frames, RenderOptions(), false);
+    printf("  %-24s avg %7.3f ms/frame\n", "flat", flat.avgMs);
+
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    bool identical = true;
+    uint64_t referenceHash = 0;
+    for (SimdLevel level : levels)
+    {
+        std::string name = std::string("textured ") + SimdLevelName(level);
+        if (ClampSimdLevel(level) != level)
+        {
+            printf("  %-24s not supported on this CPU\n", name.c_str());
+            continue;
+        }
+
+        RenderOptions options;
+        options.floor = FloorMode::Textured;
+        options.simd = level;
+        RunResult check = RunFrames(atlas, fb, frames, options, true);
+        RunResult run = RunFrames(atlas, fb, frames, options, false);
+
+        if (level == SimdLevel::Scalar)
+            referenceHash = check.hash;
+        const bool same = check.hash == referenceHash;
+        identical = identical && same;
+
+        printf("  %-24s avg %7.3f ms/frame (floor %6.3f), %+.0f%% against flat%s\n", name.c_str(), run.avgMs,
+               run.stages.floorMs / frames, (run.avgMs / flat.avgMs - 1.0) * 100.0, same ? "" : "  OUTPUT DIFFERS");
+    }
+    return identical;
+}
+
+// time the serial renderer against the band-parallel one with 2, 4, 8... threads
+static bool BenchThreads(const TextureAtlas &atlas, Framebuffer &fb, int frames, int maxThreads)
+{
+    printf("%dx%d, %d frames per thread count, %d hardware threads\n", fb.width, fb.height, frames,
+           ThreadPool::HardwareThreads());
+
+    RunResult serial = RunFrames(atlas, fb, frames, RenderOptions(), true);
+    printf("  serial      avg %7.3f ms/frame\n", serial.avgMs);
+
+    bool identical = true;
+    for (int threads = 2; threads <= maxThreads; threads *= 2)
+    {
+        ThreadPool pool(threads);
+        RenderOptions options;
+        options.pool = &pool;
+
+        RunResult check = RunFrames(atlas, fb, frames, options, true);
+        RunResult run = RunFrames(atlas, fb, frames, options, false);
+        const bool same = check.hash == serial.hash;
+        identical = identical && same;
+
+        printf("  %2d threads  avg %7.3f ms/frame, %.2fx%s\n", threads, run.avgMs, serial.avgMs / run.avgMs,
+               same ? "" : "  OUTPUT DIFFERS");
+    }
+    return identical;
+}
+
+// re-simulate and re-render a recorded session as fast as possible, timing and hashing every frame. The
+// session hash changes if any frame renders differently, and the per frame hashes in the CSV show where
+static bool Replay(const InputLog &log, const TextureAtlas &atlas, const SpriteRuns &spriteRuns, Framebuffer &fb,
+                   const RenderOptions &options, const char *csvPath)
+{
+    FILE *csv = nullptr;
+    if (csvPath)
+    {
+        csv = fopen(csvPath, "w");
+        if (!csv)
+        {
+            fprintf(stderr, "Could not write %s\n", csvPath);
+            return false;
+        }
+        fprintf(csv, "frame,sim_ms,render_ms,hash\n");
+    }
+
+    Simulation simulation;
+    simulation.enemyManager.SetPathMode(log.pathMode);
+    simulation.weapon.SetConfig(log.weapon);
+    simulation.Reset(log.seed);
+    std::vector<Sprite> sprites;
+
+    using Clock = std::chrono::steady_clock;
+    const size_t frameCount = log.frames.size();
+    std::vector<double> renderMs(frameCount);
+    double simMs = 0.0;
+    double playedSeconds = 0.0;
+    uint64_t sessionHash = 14695981039346656037ull;
+
+    for (size_t frame = 0; frame < frameCount; ++frame)
+    {
+        PROFILE_FRAME();
+        PROFILE_ZONE("Frame");
+        const FrameInput &input = log.frames[frame];
+        playedSeconds += input.dt;
+
+        const auto start = Clock::now();
+        simulation.Step(input);
+        const auto renderStart = Clock::now();
+
+        Camera camera;
+        camera.x = simulation.player.pos.x;
+        camera.y = simulation.player.pos.y;
+        camera.angle = simulation.player.angle;
+        camera.planeHalf = std::tan(60.0f * (3.14159265f / 180.0f) * 0.5f);
+        RenderFrame(camera, GetWorldMap(), atlas, fb, options);
+        sprites.clear();
+        simulation.enemyManager.CollectSprites(sprites);
+        DrawSprites(camera, sprites, atlas, spriteRuns, fb);
+        const auto end = Clock::now();
+        fb.ClearDirtyRows();
+
+        const double sim = std::chrono::duration<double, std::milli>(renderStart - start).count();
+        simMs += sim;
+        renderMs[frame] = std::chrono::duration<double, std::milli>(end - renderStart).count();
+
+        const uint64_t frameHash = HashPixels(14695981039346656037ull, fb);
+        sessionHash = (sessionHash ^ frameHash) * 1099511628211ull;
+        if (csv)
+            fprintf(csv, "%zu,%.4f,%.4f,%016llx\n", frame, sim, renderMs[frame], (unsigned long long)frameHash);
+    }
+    if (csv)
+        fclose(csv);
+
+    if (frameCount == 0)
+    {
+        printf("replay has no frames\n");
+        return true;
+    }
+
+    std::vector<double> sorted = renderMs;
+    std::sort(sorted.begin(), sorted.end());
+    double totalMs = 0.0;
+    for (double ms : renderMs)
+        totalMs += ms;
+    printf("replayed %zu frames (%.1f s of play, seed %u) at %dx%d\n", frameCount, playedSeconds, log.seed, fb.width,
+           fb.height);
+    printf("  simulation avg %.3f ms/frame\n", simMs / frameCount);
+    printf("  render     avg %.3f ms/frame, median %.3f ms, 99%% %.3f ms, max %.3f ms\n", totalMs / frameCount,
+           sorted[frameCount / 2], sorted[std::min(frameCount - 1, frameCount * 99 / 100)], sorted.back());
+    printf("  session hash %016llx\n", (unsigned long long)sessionHash);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int width = 1280;
+    int height = 720;
+    int frames = 300;
+    std::string texturePath = ASSETS_DIR "/walls.bmp";
+    int threads = 1;
+    const char *outPath = nullptr;
+    bool benchLayout = false;
+    bool benchThreads = false;
+    bool benchRays = false;
+    bool benchMips = false;
+    bool benchFloor = false;
+    bool benchSprites = false;
+    bool texturedFloor = false;
+    bool indexed = false;
+    float fogDistance = 0.0f;
+    bool sprites = false;
+    bool sizeGiven = false;
+    const char *replayPath = nullptr;
+    const char *replayCsvPath = nullptr;
+    const char *mapPath = nullptr;
+    const char *tracePath = nullptr;
+    int traceFrames = 60;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--size") && hasValue)
+        {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+            {
+                fprintf(stderr, "Invalid size %s (expected WxH)\n", argv[i]);
+                return 1;
+            }
+            sizeGiven = true;
+        }
+        else if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--textures") && hasValue)
+            texturePath = argv[++i];
+        else if (!strcmp(argv[i], "--out") && hasValue)
+            outPath = argv[++i];
+        else if (!strcmp(argv[i], "--bench-layout"))
+            benchLayout = true;
+        else if (!strcmp(argv[i], "--bench-threads"))
+            benchThreads = true;
+        else if (!strcmp(argv[i], "--bench-rays"))
+            benchRays = true;
+        else if (!strcmp(argv[i], "--bench-mips"))
+            benchMips = true;
+        else if (!strcmp(argv[i], "--bench-floor"))
+            benchFloor = true;
+        else if (!strcmp(argv[i], "--bench-sprites"))
+            benchSprites = true;
+        else if (!strcmp(argv[i], "--textured-floor"))
+            texturedFloor = true;
+        else if (!strcmp(argv[i], "--indexed"))
+            indexed = true;
+        else if (!strcmp(argv[i], "--fog") && hasValue)
+            fogDistance = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--sprites"))
+            sprites = true;
+        else if (!strcmp(argv[i], "--trace") && hasValue)
+            tracePath = argv[++i];
+        else if (!strcmp(argv[i], "--trace-frames") && hasValue)
+            traceFrames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--replay") && hasValue)
+            replayPath = argv[++i];
+        else if (!strcmp(argv[i], "--replay-csv") && hasValue)
+            replayCsvPath = argv[++i];
+        else if (!strcmp(argv[i], "--map") && hasValue)
+            mapPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--size WxH] [--frames N] [--threads N] [--textures walls.bmp] [--out frame.bmp]\n"
+                            "       [--textured-floor] [--indexed] [--fog D] [--sprites] [--bench-layout] [--bench-threads] [--bench-rays] [--bench-mips]\n"
+                            "       [--bench-floor] [--bench-sprites] [--trace trace.json|trace.csv] [--trace-frames N]\n"
+                            "       [--replay session.log] [--replay-csv frames.csv] [--map level.rcmap]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    MapFile mapFile;
+    if (mapPath)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!mapFile.Open(mapPath))
+            return 1;
+        SetWorldMap(mapFile.GetMap());
+        printf("%s: %dx%d tiles, opened in %.3f ms\n", mapPath, mapFile.GetMap().width, mapFile.GetMap().height,
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    TextureAtlas atlas;
+    if (!atlas.Load(texturePath.c_str(), texture_wall_size))
+        return 1;
+
+    SpriteRuns spriteRuns;
+    spriteRuns.Build(atlas);
+
+    IndexedTextures indexedTextures;
+    if (indexed || benchLayout)
+        indexedTextures.Build(atlas);
+
+    Framebuffer fb;
+    fb.Resize(width, height);
+
+    if (benchLayout)
+        return BenchLayouts(atlas, indexedTextures, fb, frames) ? 0 : 1;
+    if (benchRays)
+        return BenchRays(width, frames) ? 0 : 1;
+    if (benchThreads)
+        return BenchThreads(atlas, fb, frames, threads > 1 ? threads : 8) ? 0 : 1;
+    if (benchMips)
+    {
+        BenchMips(atlas, fb, frames);
+        return 0;
+    }
+    if (benchFloor)
+        return BenchFloor(atlas, fb, frames) ? 0 : 1;
+    if (benchSprites)
+    {
+        BenchSprites(atlas, spriteRuns, fb, frames);
+        return 0;
+    }
+
+    ThreadPool pool(threads);
+    RenderOptions options;
+    if (threads > 1)
+        options.pool = &pool;
+    if (texturedFloor)
+        options.floor = FloorMode::Textured;
+    if (indexed)
+    {
+        options.layout = FramebufferLayout::IndexedColumns;
+        options.indexed = &indexedTextures;
+        options.fogDistance = fogDistance;
+    }
+
+    // a recorded session replays on the level it was recorded on, opened from the path in the log unless
+    // --map gives it, and renders at its window size unless --size overrides it
+    if (replayPath)
+    {
+        InputLog log;
+        if (!log.Load(replayPath))
+            return 1;
+        if (!mapPath && !log.mapPath.empty())
+        {
+            if (!mapFile.Open(log.mapPath.c_str()))
+                return 1;
+            SetWorldMap(mapFile.GetMap());
+        }
+        const Map &map = GetWorldMap();
+        const uint64_t checksum = MapChecksum(map);
+        if (map.width != log.mapWidth || map.height != log.mapHeight || checksum != log.mapChecksum)
+        {
+            fprintf(stderr, "%s was recorded on %s (%dx%d, checksum %016llx), not on %s (%dx%d, checksum %016llx)\n",
+                    replayPath, log.mapPath.empty() ? "the built-in map" : log.mapPath.c_str(), log.mapWidth,
+                    log.mapHeight, (unsigned long long)log.mapChecksum, mapPath ? mapPath : "the built-in map",
+                    map.width, map.height, (unsigned long long)checksum);
+            return 1;
+        }
+        if (!sizeGiven && log.width > 0 && log.height > 0)
+            fb.Resize(log.width, log.height);
+        if (!Replay(log, atlas, spriteRuns, fb, options, replayCsvPath))
+            return 1;
+        if (tracePath && !Profiler::WriteTrace(tracePath, traceFrames))
+            return 1;
+        return outPath && !SaveBMP(outPath, fb.Pixels(), fb.width, fb.height, fb.pitch) ? 1 : 0;
+    }
+
+    RunResult run = RunFrames(atlas, fb, frames, options, false, sprites ? TestSprites() : std::vector<Sprite>(),
+                              &spriteRuns);
+    if (frames > 0)
+    {
+        printf("%dx%d, %d frames (%s, %d threads): avg %.3f ms/frame, min %.3f ms, max %.3f ms\n",
+               width, height, frames, SimdLevelName(BestSimdLevel()), threads, run.avgMs, run.minMs, run.maxMs);
+        printf("  %.0f of %d rows changed per frame (%.0f%%)\n", run.dirtyRows, height, 100.0 * run.dirtyRows / height);
+    }
+
+    if (outPath && !SaveBMP(outPath, fb.Pixels(), fb.width, fb.height, fb.pitch))
+        return 1;
+
+    // Chrome trace_event JSON, or CSV for a path ending in .csv
+    if (tracePath && !Profiler::WriteTrace(tracePath, traceFrames))
+        return 1;
+
+    return 0;
+}
@@ -13,10 +13,16 @@
 #include <random>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
 
 #include "raycastTest.h"
+#include "Raycaster.h"
 #include "Player.h"
 #include "EnemyManager.h"
+#include "InputLog.h"
+#include "MapFile.h"
+#include "Profiler.h"
+#include "Simulation.h"
 
 // ------------------------------------------------------------
 // Window and Render Stuff
@@ -26,13 +32,20 @@ static ID2D1Factory *pFactory = NULL;
 static ID2D1HwndRenderTarget *pRenderTarget = NULL;
 
 // Game Stuff
-static Player *player = NULL;
-static EnemyManager enemyManager;
+static Simulation simulation;
 static Uint64 ticks_prev = 0;
 static float dt = 0.0f;
-static bool gameClear = false;
+static float mouseDx = 0.0f; // mouse motion since the last frame
 
-SDL_Surface *textureBitmap = NULL;
+// Every frame's input is appended here (--record FILE), for Headless --replay
+static InputRecorder recorder;
+
+// Level played instead of the built-in map (--map FILE), mapped for the whole run
+static MapFile levelFile;
+
+TextureAtlas textureAtlas;
+IndexedTextures indexedTextures; // 8-bit palette copy of textureAtlas (--indexed)
+SpriteRuns spriteRuns;           // opaque runs of the sprite columns in textureAtlas
 
 // Brushes
 ID2D1SolidColorBrush *ceilBrush = NULL;
@@ -43,7 +56,22 @@ ID2D1SolidColorBrush *enemyBrush = NULL;
 // Wall Bitmap (screen-sized)
 ID2D1Bitmap *bitmap = NULL;
 D2D1_SIZE_U size;
-std::vector<BYTE> pixels;
+Framebuffer frame;
+static std::vector<Sprite> sprites; // enemy billboards composited into frame
+
+// Workers the wall raycasting is split across (--threads N, defaults to all hardware threads)
+static ThreadPool *renderPool = NULL;
+static FloorMode floorMode = FloorMode::Flat;
+static bool indexedRendering = false;
+static float fogDistance = 0.0f;
+
+// Profiler zones of the last traceFrames frames are written here at exit (--trace FILE, .csv for CSV)
+static const char *tracePath = NULL;
+static int traceFrames = 300;
+
+// FPS shown in the window title, averaged over fps_refresh_time
+static float fpsTime = 0.0f;
+static int fpsFrames = 0;
 
 // Crosshair
 D2D1_ELLIPSE crosshair;
@@ -251,30 +279,81 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
     const int height = static_cast<int>(rtSize.height);
 
     size = D2D1::SizeU(width, height);
-    pixels = std::vector<BYTE>(width * height * 4);
+    frame.Resize(width, height);
 
-    player = new Player();
+    int renderThreads = ThreadPool::HardwareThreads();
+    const char *recordPath = NULL;
+    const char *mapPath = NULL;
+    uint32_t seed = (uint32_t)std::random_device{}();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            renderThreads = SDL_max(1, atoi(argv[i + 1]));
+        if (!strcmp(argv[i], "--textured-floor"))
+            floorMode = FloorMode::Textured;
+        if (!strcmp(argv[i], "--indexed"))
+            indexedRendering = true;
+        if (!strcmp(argv[i], "--fog") && i + 1 < argc)
+            fogDistance = (float)atof(argv[i + 1]);
+        if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            tracePath = argv[i + 1];
+        if (!strcmp(argv[i], "--trace-frames") && i + 1 < argc)
+            traceFrames = SDL_max(1, atoi(argv[i + 1]));
+        if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            recordPath = argv[i + 1];
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        if (!strcmp(argv[i], "--map") && i + 1 < argc)
+            mapPath = argv[i + 1];
+        if (!strcmp(argv[i], "--flow-field"))
+            simulation.enemyManager.SetPathMode(PathMode::FlowField);
+        if (!strcmp(argv[i], "--hpa"))
+            simulation.enemyManager.SetPathMode(PathMode::Hierarchical);
+        if (!strcmp(argv[i], "--shotgun"))
+            simulation.weapon.SetConfig(shotgun);
+    }
+    if (mapPath)
+    {
+        const Uint64 mapStart = SDL_GetPerformanceCounter();
+        if (!levelFile.Open(mapPath))
+        {
+            SDL_Log("Failed to open level %s", mapPath);
+            return SDL_APP_FAILURE;
+        }
+        SetWorldMap(levelFile.GetMap());
+        SDL_Log("Level %s: %dx%d tiles, opened in %.3f ms", mapPath, levelFile.GetMap().width,
+                levelFile.GetMap().height,
+                1000.0 * (SDL_GetPerformanceCounter() - mapStart) / SDL_GetPerformanceFrequency());
+    }
+    renderPool = new ThreadPool(renderThreads);
+    SDL_Log("Rendering walls on %d threads", renderThreads);
+
+    simulation.Reset(seed);
     ticks_prev = SDL_GetTicks();
-    enemyManager.Reset();
+    if (recordPath && recorder.Open(recordPath, seed, width, height, simulation.weapon.GetConfig(),
+                                    simulation.enemyManager.GetPathMode(), mapPath, GetWorldMap()))
+        SDL_Log("Recording input to %s (seed %u)", recordPath, seed);
 
     pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.1f, 0.1f, 0.15f, 1.0f), &ceilBrush);
     pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.2f, 0.2f, 0.22f, 1.0f), &floorBrush);
     pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.9f, 0.9f, 0.9f, 1.0f), &wallBrush);
     pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(1.0f, 0.0f, 0.0f, 1.0f), &enemyBrush);
 
-    // Load wall texture atlas (still BMP via SDL, since you sample pixels from it)
-    textureBitmap = SDL_LoadBMP("../../Assets/walls.bmp");
-    if (!textureBitmap)
+    // Load wall and sprite texture atlas, decoded once into column-major tiles
+    if (!textureAtlas.Load("../../Assets/walls.bmp", texture_wall_size))
     {
-        SDL_Log("Failed to load walls.bmp: %s", SDL_GetError());
+        SDL_Log("Failed to load walls.bmp");
         return SDL_APP_FAILURE;
     }
+    spriteRuns.Build(textureAtlas);
+    if (indexedRendering)
+        indexedTextures.Build(textureAtlas);
 
     // Create screen-sized bitmap we will update each frame
     hr = pRenderTarget->CreateBitmap(
         size,
-        pixels.data(),
-        width * 4,
+        frame.Pixels(),
+        (UINT32)frame.pitch * 4,
         &uiBmpProps,
         &bitmap);
 
@@ -284,9 +363,6 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
         return SDL_APP_FAILURE;
     }
 
-    enemyManager.CreateBillboardRenderer(pRenderTarget, width, height);
-    enemyManager.InitializeTargets(5, player->pos);
-
     crosshair = D2D1::Ellipse(
         D2D1::Point2F((FLOAT)(width / 2), (FLOAT)(height / 2)),
         25.0f, 25.0f);
@@ -306,12 +382,6 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
     overlayBmpCurrent = overlayBmpA;
 
-    if (!mapCheck())
-    {
-        fprintf(stderr, "Map is invalid!\n");
-        return SDL_APP_FAILURE;
-    }
-
     return SDL_APP_CONTINUE;
 }
 
@@ -333,8 +403,7 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 
     if (event->type == SDL_EVENT_MOUSE_MOTION)
     {
-        const float sensitivity = 0.0025f;
-        player->angle += event->motion.xrel * sensitivity;
+        mouseDx += event->motion.xrel; // turned by the next simulation step
     }
 
     return SDL_APP_CONTINUE;
@@ -343,15 +412,28 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 /* This function runs once per frame, and is the heart of the program. */
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
+    PROFILE_FRAME();
+    PROFILE_ZONE("Frame");
+
     const Uint64 now = SDL_GetTicks();
     dt = (float)(now - ticks_prev) / 1000.0f;
     ticks_prev = now;
 
-    D2D_POINT_2F forward = {std::cos(player->angle), std::sin(player->angle)};
-    D2D_POINT_2F right = {-std::sin(player->angle), std::cos(player->angle)};
+    fpsTime += dt;
+    ++fpsFrames;
+    if (fpsTime >= fps_refresh_time)
+    {
+        char title[64];
+        SDL_snprintf(title, sizeof(title), "D2DFPS - %.0f FPS (%.2f ms)", fpsFrames / fpsTime, 1000.0f * fpsTime / fpsFrames);
+        SDL_SetWindowTitle(window, title);
+        fpsTime = 0.0f;
+        fpsFrames = 0;
+    }
 
-    D2D_POINT_2F desired = {0.0f, 0.0f};
-    D2D_POINT_2U texture_coords = {0, 0};
+    FrameInput input;
+    input.dt = dt;
+    input.mouseDx = mouseDx;
+    mouseDx = 0.0f;
 
     D2D1_SIZE_F rtSize = pRenderTarget->GetSize();
     const int width = static_cast<int>(rtSize.width);
@@ -359,6 +441,7 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 
     // Inputs
     {
+        PROFILE_ZONE("Input");
         const bool *key_states = SDL_GetKeyboardState(NULL);
         D2D_POINT_2F mousePos = D2D1::Point2F(0.0f, 0.0f);
         Uint32 mouseInputs = SDL_GetMouseState(&mousePos.x, &mousePos.y);
@@ -373,61 +456,20 @@ SDL_AppResult SDL_AppIterate(void *appstate)
         }
         prevLeftDown = leftDown;
 
-        // Your existing shooting logic (kept)
         if (leftDown)
-        {
-            D2D_POINT_2F rayDir = {std::cos(player->angle), std::sin(player->angle)};
-            D2D_POINT_2F hitPos;
-            const float enemyCheckProximity = 0.5f;
-
-            float hitDistance = checkEnemyHit(player->pos, rayDir, hitPos, enemyManager);
-
-            if (hitDistance < 1e30f)
-            {
-                if (enemyManager.RemoveEnemyAt(hitPos, enemyCheckProximity))
-                {
-                    SDL_Log("Enemy destroyed at distance: %f", hitDistance);
-
-                    if (enemyManager.CountTargets() == 0)
-                    {
-                        gameClear = true;
-                        enemyManager.SetSpawningEnabled(false);
-                        enemyManager.DestroyAllEnemies();
-                        SDL_Log("Game Clear: All targets destroyed. Enemies stopped and cleared.");
-                    }
-                }
-            }
-        }
-
+            input.buttons |= ButtonFire;
         if (key_states[SDL_SCANCODE_W])
-        {
-            desired.x += forward.x;
-            desired.y += forward.y;
-        }
+            input.buttons |= ButtonForward;
         if (key_states[SDL_SCANCODE_S])
-        {
-            desired.x -= forward.x;
-            desired.y -= forward.y;
-        }
+            input.buttons |= ButtonBack;
         if (key_states[SDL_SCANCODE_A])
-        {
-            desired.x -= right.x;
-            desired.y -= right.y;
-        }
+            input.buttons |= ButtonStrafeLeft;
         if (key_states[SDL_SCANCODE_D])
-        {
-            desired.x += right.x;
-            desired.y += right.y;
-        }
-
+            input.buttons |= ButtonStrafeRight;
         if (key_states[SDL_SCANCODE_Q])
-        {
-            player->angle -= player->rotSpeed * dt;
-        }
+            input.buttons |= ButtonTurnLeft;
         if (key_states[SDL_SCANCODE_E])
-        {
-            player->angle += player->rotSpeed * dt;
-        }
+            input.buttons |= ButtonTurnRight;
 
         if (key_states[SDL_SCANCODE_ESCAPE])
         {
@@ -441,23 +483,8 @@ SDL_AppResult SDL_AppIterate(void *appstate)
     }
 
     // Update
-    float len = std::sqrt(desired.x * desired.x + desired.y * desired.y);
-    if (len > 0.0001f)
-    {
-        desired.x /= len;
-        desired.y /= len;
-    }
-
-    D2D_POINT_2F nextPos = {player->pos.x + desired.x * player->moveSpeed * dt,
-                            player->pos.y + desired.y * player->moveSpeed * dt};
-
-    D2D_POINT_2F playerSize = {0.35f, 0.35f};
-    if (canMove(nextPos, playerSize))
-    {
-        player->pos = nextPos;
-    }
-
-    enemyManager.Update(dt, player->pos);
+    recorder.Write(input);
+    simulation.Step(input);
 
     if (uiFlashTimer > 0.0f)
 {
@@ -476,161 +503,52 @@ SDL_AppResult SDL_AppIterate(void *appstate)
         pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black));
 
         const float halfH = rtSize.height * 0.5f;
-        pRenderTarget->FillRectangle(D2D1::RectF(0, 0, rtSize.width, halfH), ceilBrush);
-        pRenderTarget->FillRectangle(D2D1::RectF(0, halfH, rtSize.width, rtSize.height), floorBrush);
+        if (floorMode == FloorMode::Flat)
+        {
+            pRenderTarget->FillRectangle(D2D1::RectF(0, 0, rtSize.width, halfH), ceilBrush);
+            pRenderTarget->FillRectangle(D2D1::RectF(0, halfH, rtSize.width, rtSize.height), floorBrush);
+        }
 
         const float fov = 60.0f * (3.14159265f / 180.0f);
         const float planeHalf = std::tan(fov * 0.5f);
 
-        static std::vector<float> depthBuffer;
-        depthBuffer.assign(width, 1e30f);
+        Camera camera;
+        camera.x = simulation.player.pos.x;
+        camera.y = simulation.player.pos.y;
+        camera.angle = simulation.player.angle;
+        camera.planeHalf = planeHalf;
 
-        std::fill(pixels.begin(), pixels.end(), 0x00);
+        RenderOptions renderOptions;
+        renderOptions.pool = renderPool;
+        renderOptions.floor = floorMode;
+        if (indexedRendering)
+        {
+            renderOptions.layout = FramebufferLayout::IndexedColumns;
+            renderOptions.indexed = &indexedTextures;
+            renderOptions.fogDistance = fogDistance;
+        }
+
+        frame.Resize(width, height);
+        RenderFrame(camera, GetWorldMap(), textureAtlas, frame, renderOptions);
 
-        for (int x = 0; x < width; ++x)
         {
-            float camX = ((2.0f * x) / (float)width) - 1.0f;
-
-            D2D_POINT_2F dir = {
-                std::cos(player->angle) + planeHalf * camX * (-std::sin(player->angle)),
-                std::sin(player->angle) + planeHalf * camX * (std::cos(player->angle))};
-
-            int mapX = (int)player->pos.x;
-            int mapY = (int)player->pos.y;
-
-            float sideDistX;
-            float sideDistY;
-
-            float deltaDistX = (dir.x == 0.0f) ? 1e30f : std::fabs(1.0f / dir.x);
-            float deltaDistY = (dir.y == 0.0f) ? 1e30f : std::fabs(1.0f / dir.y);
-
-            int stepX;
-            int stepY;
-
-            int hit = 0;
-            int side = 0;
-            int tile = 0;
-
-            if (dir.x < 0)
-            {
-                stepX = -1;
-                sideDistX = (player->pos.x - mapX) * deltaDistX;
-            }
-            else
-            {
-                stepX = 1;
-                sideDistX = (mapX + 1.0f - player->pos.x) * deltaDistX;
-            }
-
-            if (dir.y < 0)
-            {
-                stepY = -1;
-                sideDistY = (player->pos.y - mapY) * deltaDistY;
-            }
-            else
-            {
-                stepY = 1;
-                sideDistY = (mapY + 1.0f - player->pos.y) * deltaDistY;
-            }
-
-            while (!hit)
-            {
-                if (sideDistX < sideDistY)
-                {
-                    sideDistX += deltaDistX;
-                    mapX += stepX;
-                    side = 0;
-                }
-                else
-                {
-                    sideDistY += deltaDistY;
-                    mapY += stepY;
-                    side = 1;
-                }
-
-                tile = getTile(mapX, mapY);
-
-                if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight)
-                {
-                    hit = 1;
-                    break;
-                }
-                if (tile != '.')
-                {
-                    hit = 1;
-                }
-            }
-
-            float perpWallDist = (side == 0) ? (sideDistX - deltaDistX) : (sideDistY - deltaDistY);
-            if (perpWallDist < 0.0001f)
-                perpWallDist = 0.0001f;
-
-            int lineHeight = (int)(height / perpWallDist);
-            int drawStart = -lineHeight / 2 + (int)halfH;
-            int drawEnd = lineHeight / 2 + (int)halfH;
-            if (drawStart < 0)
-                drawStart = 0;
-            if (drawEnd >= height)
-                drawEnd = height - 1;
-
-            int wallTextureNum = (int)wallTypes.find(tile)->second;
-
-            double wallX;
-            if (side == 0)
-                wallX = player->pos.y + perpWallDist * dir.y;
-            else
-                wallX = player->pos.x + perpWallDist * dir.x;
-            wallX -= floor(wallX);
-
-            int texX = int(wallX * double(texture_wall_size));
-            if (side == 0 && dir.x > 0)
-                texX = texture_wall_size - texX - 1;
-            if (side == 1 && dir.y < 0)
-                texX = texture_wall_size - texX - 1;
-
-            double step = 1.0 * double(texture_wall_size) / lineHeight;
-            double texPos = (drawStart - height / 2 + lineHeight / 2) * step;
-
-            float shade = (side == 1) ? 0.75f : 1.0f;
-
-            texture_coords.x = texX + (wallTextureNum % 4) * texture_wall_size;
-
-            for (int y = 0; y < height; y++)
-            {
-                int currentPixel = (y * width + x) * 4;
-
-                if (y <= drawStart || y >= drawEnd)
-                {
-                    pixels[currentPixel + 0] = 0x00;
-                    pixels[currentPixel + 1] = 0x00;
-                    pixels[currentPixel + 2] = 0x00;
-                    pixels[currentPixel + 3] = 0x00;
-                    continue;
-                }
-
-                int texY = (int)texPos & (texture_wall_size - 1);
-                texPos += step;
-
-                texture_coords.y = texY + (wallTextureNum / 4) * texture_wall_size;
-
-                SDL_Color pixelColor = GetPixelColor(textureBitmap, texture_coords.x, texture_coords.y);
-
-                pixels[currentPixel + 0] = BYTE(pixelColor.b * shade);
-                pixels[currentPixel + 1] = BYTE(pixelColor.g * shade);
-                pixels[currentPixel + 2] = BYTE(pixelColor.r * shade);
-                pixels[currentPixel + 3] = 0xFF;
-            }
-
-            depthBuffer[x] = perpWallDist;
+            PROFILE_ZONE("CollectSprites");
+            sprites.clear();
+            simulation.enemyManager.CollectSprites(sprites);
         }
+        DrawSprites(camera, sprites, textureAtlas, spriteRuns, frame);
 
-        bitmap->CopyFromMemory(nullptr, pixels.data(), width * 4);
+        // one upload of the composited frame, only the rows that changed since the last one
+        if (frame.dirtyTop < frame.dirtyBottom)
+        {
+            PROFILE_ZONE("CopyFromMemory");
+            D2D1_RECT_U rows = D2D1::RectU(0, frame.dirtyTop, width, frame.dirtyBottom);
+            bitmap->CopyFromMemory(&rows, frame.Row(frame.dirtyTop), (UINT32)frame.pitch * 4);
+        }
+        frame.ClearDirtyRows();
 
         pRenderTarget->DrawBitmap(bitmap, D2D1::RectF(0, 0, (FLOAT)width, (FLOAT)height));
 
-        enemyManager.RenderBillboards(pRenderTarget, enemyBrush, textureBitmap, depthBuffer,
-                                      width, height, halfH, player->pos, player->angle, planeHalf);
-
         pRenderTarget->DrawEllipse(crosshair, enemyBrush);
         pRenderTarget->DrawRectangle(crossCenter, enemyBrush);
 
@@ -643,7 +561,10 @@ SDL_AppResult SDL_AppIterate(void *appstate)
             pRenderTarget->DrawBitmap(overlayBmpCurrent, dst, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
         }
     }
-    pRenderTarget->EndDraw();
+    {
+        PROFILE_ZONE("EndDraw");
+        pRenderTarget->EndDraw();
+    }
 
     return SDL_APP_CONTINUE;
 }
@@ -651,6 +572,12 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 /* This function runs once at shutdown. */
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
+    if (tracePath)
+    {
+        if (Profiler::WriteTrace(tracePath, traceFrames))
+            SDL_Log("Wrote the last %d frames of profiler zones to %s", traceFrames, tracePath);
+    }
+
     SafeRelease(overlayBmpA);
     SafeRelease(overlayBmpB);
     overlayBmpCurrent = nullptr;
@@ -663,12 +590,6 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
         gComInitialized = false;
     }
 
-    if (textureBitmap)
-    {
-        SDL_DestroySurface(textureBitmap);
-        textureBitmap = nullptr;
-    }
-
     if (renderer)
     {
         SDL_DestroyRenderer(renderer);
@@ -680,8 +601,10 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
         window = nullptr;
     }
 
-    delete player;
-    player = nullptr;
+    recorder.Close();
+
+    delete renderPool;
+    renderPool = nullptr;
 
     SafeRelease(bitmap);
     SafeRelease(ceilBrush);
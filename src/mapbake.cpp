@@ -0,0 +1,90 @@
+// mapbake.cpp - bakes levels into the memory-mapped .rcmap format the game, Headless and bench load with --map
+//
+// usage: MapBake level.txt out.rcmap       text level, one row of tile glyphs per line
+//        MapBake --builtin out.rcmap       the built-in worldMap
+//        MapBake --generate WxH out.rcmap  a generated grid of rooms, for testing very large levels
+//
+// Every level is validated here, so the game doesn't have to check the tiles when it opens one.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "MapFile.h"
+
+// rooms of roomSize x roomSize floor tiles (the last row and column of rooms take up the rest) with walls
+// between them and a door in the middle of every wall, so the whole level is connected. Some walls get
+// another texture so the level isn't all one color
+static bool GenerateRooms(int width, int height, std::vector<char> &tiles, Map &map)
+{
+    const int roomSize = 7;
+    const int cell = roomSize + 1;
+    if (width < cell + 1 || height < cell + 1 || width > maxMapSide || height > maxMapSide)
+    {
+        fprintf(stderr, "Generated levels are %d to %d tiles per side\n", cell + 1, maxMapSide);
+        return false;
+    }
+
+    static const char walls[] = {'#', '!', '=', 'M'};
+    tiles.assign((size_t)width * height, '#');
+    for (int y = 1; y < height - 1; ++y)
+        for (int x = 1; x < width - 1; ++x)
+        {
+            const int cx = x / cell, cy = y / cell;
+            const bool wallX = x % cell == 0 && x + cell < width;
+            const bool wallY = y % cell == 0 && y + cell < height;
+            const bool doorX = wallX && y % cell == cell / 2;
+            const bool doorY = wallY && x % cell == cell / 2;
+            char &tile = tiles[(size_t)y * width + x];
+            if ((!wallX && !wallY) || doorX || doorY)
+                tile = '.';
+            else
+                tile = walls[(cx * 7 + cy * 13) % 4];
+        }
+
+    map = GetBuiltinMap();
+    map.width = width;
+    map.height = height;
+    map.tiles = tiles.data();
+    map.startX = cell / 2 + 0.5f;
+    map.startY = cell / 2 + 0.5f;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<char> tiles;
+    Map map;
+    const char *outPath = nullptr;
+    int width = 0, height = 0;
+
+    if (argc == 3 && !strcmp(argv[1], "--builtin"))
+    {
+        map = GetBuiltinMap();
+        outPath = argv[2];
+    }
+    else if (argc == 4 && !strcmp(argv[1], "--generate"))
+    {
+        if (sscanf(argv[2], "%dx%d", &width, &height) != 2 || !GenerateRooms(width, height, tiles, map))
+            return 1;
+        outPath = argv[3];
+    }
+    else if (argc == 3 && argv[1][0] != '-')
+    {
+        if (!ImportTextMap(argv[1], tiles, map))
+            return 1;
+        outPath = argv[2];
+    }
+    else
+    {
+        fprintf(stderr, "usage: %s level.txt out.rcmap\n"
+                        "       %s --builtin out.rcmap\n"
+                        "       %s --generate WxH out.rcmap\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if (!SaveMapFile(outPath, map))
+        return 1;
+    printf("%s: %dx%d tiles\n", outPath, map.width, map.height);
+    return 0;
+}
@@ -1,85 +1,18 @@
 #pragma once
 
-#include <Windows.h>
-#include <SDL3/SDL.h>
-#include <unordered_map>
-#include <d2d1.h>
+#include "Platform.h"
 
-class EnemyManager;
-
-const int texture_size = 512;      // size(width and height) of texture that will hold all wall textures
-const int texture_wall_size = 128; // size(width and height) of each wall type in the full texture
+#include "Map.h"
+#include "Texture.h"
 
 const float fps_refresh_time = 0.1f; // time between FPS text refresh. FPS is smoothed out over this time
 
-// list of wall texture types, in order as they appear in the full texture
-enum class WallTexture
-{
-    Smiley,
-    Red,
-    Bush,
-    Sky,
-    Pink,
-    Wallpaper,
-    Dirt,
-    Exit,
-};
-
-// valid wall types and their texture for the world map
-const std::unordered_map<char, WallTexture> wallTypes{
-    {'#', WallTexture::Pink},
-    {'=', WallTexture::Dirt},
-    {'M', WallTexture::Wallpaper},
-    {'N', WallTexture::Bush},
-    {'~', WallTexture::Sky},
-    {'!', WallTexture::Red},
-    {'@', WallTexture::Smiley},
-    {'^', WallTexture::Exit},
-};
-
-// size of the top-down world map in tiles
-const int mapWidth = 24;
-const int mapHeight = 24;
-
-// top-down view of world map
-const char worldMap[] =
-    "~~~~~~~~~~~~~~~~!!!@!!!!"
-    "~..............!!......!"
-    "~..............!@......!"
-    "~..............!!......@"
-    "~..............!!......!"
-    "~....N......N..........!"
-    "~..............!!!!@!!.!"
-    "~..............!!!!!!!.!"
-    "~..............#!!!!!!.@"
-    "~..............!!......!"
-    "~...N....N.....!!..N..!!"
-    "~.....................!!"
-    "~..............!!..N..!!"
-    "~..............!!.....!#"
-    "~...........N..!!#!!!.!!"
-    "~..............!!!!!!.!!"
-    "!.!!!!!!.!!!!!!........!"
-    "!.!....=.=..........=..!"
-    "@.!.=..=.=..!!..=...=..!"
-    "!...........!#..==..=..#"
-    "!.!!!!!!.=..!!.........!"
-    "!.!!!!!!.=..!!....=....!"
-    "!......................^"
-    "!!!#!!!!!!#!!!@!!!!#!!!!";
-
-
+#ifdef _WIN32
 const D2D1_BITMAP_PROPERTIES bmpProps =
     D2D1::BitmapProperties(
         D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM,
                           D2D1_ALPHA_MODE_PREMULTIPLIED));
-
-// get a tile from worldMap. Not memory safe.
-char getTile(int x, int y);
-
-// checks worldMap for errors
-// returns: true on success, false on errors found
-bool mapCheck();
+#endif
 
 // check if a rectangular thing with given size can move to given position without colliding with walls or
 // being outside of the map
@@ -87,9 +20,4 @@ bool mapCheck();
 bool canMove(D2D_POINT_2F position, D2D_POINT_2F size);
 
 // rotate a given vector with given float value in radians and return the result
-D2D_POINT_2F rotateVec(D2D_POINT_2F vec, float value);
-
-// get pixel from a SDL surface
-SDL_Color GetPixelColor(SDL_Surface* surface, int x, int y);
-
-float checkEnemyHit(const D2D_POINT_2F &rayPos, const D2D_POINT_2F &rayDir, D2D_POINT_2F &hitPos, EnemyManager &enemyManager);
\ No newline at end of file
+D2D_POINT_2F rotateVec(D2D_POINT_2F vec, float value);
\ No newline at end of file